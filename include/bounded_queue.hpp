@@ -0,0 +1,76 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace comp
+{
+    /* FIFO between pipeline stages. push() blocks while `capacity` items are waiting, so a fast stage
+     * cannot run ahead of a slow one by more than that; pop() blocks until an item arrives.
+     * close() ends the stream: pop() then drains what is left and returns false.
+     */
+    template <typename T>
+    class bounded_queue
+    {
+    private:
+        bounded_queue();
+
+    public:
+        bounded_queue(size_t capacity) : capacity(capacity) {}
+
+        /* False if the queue was closed (nobody will take the item): */
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this]()
+                          { return closed || items.size() < capacity; });
+
+            if (closed)
+            {
+                return false;
+            }
+
+            items.push_back(std::move(item));
+            not_empty.notify_one();
+            return true;
+        }
+
+        bool pop(T &item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this]()
+                           { return closed || !items.empty(); });
+
+            if (items.empty())
+            {
+                return false;
+            }
+
+            item = std::move(items.front());
+            items.pop_front();
+            not_full.notify_one();
+            return true;
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+    private:
+        const size_t capacity;
+        std::deque<T> items;
+        std::mutex mutex;
+        std::condition_variable not_full, not_empty;
+        bool closed = false;
+    };
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include <cstdint>
+#include <span>
+
+namespace comp
+{
+    /* CRC32C (Castagnoli polynomial, as in iSCSI and ext4). On x86-64 CPUs with SSE4.2 it runs on the crc32 instruction,
+     * three streams at a time, picked at load time; elsewhere on tables, 8 bytes at a time.
+     */
+    class checksum
+    {
+    public:
+        /* `crc` is the result of an earlier call, to carry on over the bytes that follow it: */
+        static uint32_t crc32c(std::span<const uint8_t>, uint32_t crc = 0);
+
+        /* True if crc32c() uses the instruction: */
+        static bool hardware();
+    };
+}
+
+#endif
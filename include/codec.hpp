@@ -0,0 +1,48 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <memory>
+
+#include "stream.hpp"
+
+namespace comp
+{
+    enum class codec_id : uint8_t
+    {
+        shannon_fano = 0,
+        huffman,
+        lz77,
+        lzw
+    };
+
+    /* Buffer to buffer access to every codec, for use as a library: nothing touches a file, prints, or exits.
+     * Output is byte for byte what the tools write to their files, so the two can be mixed.
+     * `out` is overwritten but keeps its capacity; reusing one vector per caller avoids reallocation after the first call.
+     */
+    class codec
+    {
+    public:
+        static const size_t count = 4;
+
+        static void compress(codec_id, std::span<const uint8_t> in, std::vector<uint8_t> &out);
+
+        /* False if `in` is corrupt; `out` then holds whatever was decoded before the error: */
+        static bool decompress(codec_id, std::span<const uint8_t> in, std::vector<uint8_t> &out);
+
+        /* Incremental versions. LZ77 and LZW streams are the same as above; Shannon-Fano and Huffman code fixed-size blocks
+         * (see common::block_size), so their streams differ from the whole-buffer format: */
+        static std::unique_ptr<stream_coder> encoder(codec_id);
+        static std::unique_ptr<stream_coder> decoder(codec_id);
+
+        static const char *name(codec_id);
+
+        /* File extension of the matching tool: */
+        static const std::string &ext(codec_id);
+    };
+}
+
+#endif
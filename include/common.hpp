@@ -7,25 +7,56 @@
 #include <vector>
 #include <any>
 #include <memory>
+#include <span>
+
+#include "stream.hpp"
 
 namespace comp
 {
+    class stats;
+
     class common
     {
     public:
         static const std::string sf_ext;
         static const std::string hf_ext;
 
-        static void calc_prob(std::string, std::map<uint8_t, double> &);
-        static void shannon_fano_encode(const std::string &);
-        static void huffman_encode(const std::string &);
-        static void decode(const std::string &);
+        /* File to file; false (after printing why) if a file cannot be opened or is corrupt.
+         * `stats`, if given, receives stage times and code statistics: */
+        static bool calc_prob(const std::string &, std::map<uint8_t, double> &, stats * = nullptr);
+        static bool shannon_fano_encode(const std::string &, stats * = nullptr);
+        static bool huffman_encode(const std::string &, stats * = nullptr);
+        static bool decode(const std::string &, stats * = nullptr);
+
+        /* In memory, same format as the files. `out` is overwritten but keeps its capacity, so a reused buffer stops
+         * allocating once it is large enough. Nothing is printed; decode() returns false on corrupt input.
+         * Input the code would not make smaller is stored as is, behind the length (8 bytes in all). */
+        static void calc_prob(std::span<const uint8_t>, std::map<uint8_t, double> &);
+        static void shannon_fano_encode(std::span<const uint8_t>, std::vector<uint8_t> &, stats * = nullptr);
+        static void huffman_encode(std::span<const uint8_t>, std::vector<uint8_t> &, stats * = nullptr);
+        static bool decode(std::span<const uint8_t>, std::vector<uint8_t> &);
+
+        /* Or straight into a buffer of decoded_size() bytes (read from the header, which holds it): */
+        static bool decoded_size(std::span<const uint8_t>, uint64_t &);
+        static bool decode(std::span<const uint8_t>, std::span<uint8_t>);
+
         static std::string trim_string_ext(const std::string &);
 
+        /* Block mode, a fragment at a time: input is cut into `block_size` blocks, each coded on its own, so memory is bounded.
+         * Stream: { encoded size (32-bit little endian) | block, same format as above }, once per block. Both encoders share the decoder. */
+        static const size_t block_size = 1 << 16;
+        static std::unique_ptr<stream_coder> shannon_fano_encoder();
+        static std::unique_ptr<stream_coder> huffman_encoder();
+        static std::unique_ptr<stream_coder> block_decoder();
+
     private:
         struct _node;
         struct _sf_data;
-        static void _write_encoded(std::vector<std::pair<uint8_t, std::vector<bool>>> &, const std::string &, const std::string &);
+        static void _shannon_fano_codes(const std::map<uint8_t, double> &, std::vector<std::pair<uint8_t, std::vector<bool>>> &);
+        static void _huffman_codes(const std::map<uint8_t, double> &, std::vector<std::pair<uint8_t, std::vector<bool>>> &);
+        typedef void (*_code_function)(const std::map<uint8_t, double> &, std::vector<std::pair<uint8_t, std::vector<bool>>> &);
+        static void _encode(_code_function, std::span<const uint8_t>, std::vector<uint8_t> &, stats *);
+        static void _write_encoded(std::vector<std::pair<uint8_t, std::vector<bool>>> &, std::span<const uint8_t>, std::vector<uint8_t> &);
         static void _shannon_fano(std::vector<struct _sf_data> &, uint8_t, uint8_t, double);
         static void _huffman_code_gen(std::shared_ptr<comp::common::_node> &, std::vector<bool> &, std::map<uint8_t, std::vector<bool>> &);
         static std::shared_ptr<comp::common::_node> join_nodes(std::shared_ptr<comp::common::_node>, std::shared_ptr<comp::common::_node>);
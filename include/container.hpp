@@ -0,0 +1,65 @@
+#ifndef CONTAINER_HPP
+#define CONTAINER_HPP
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <memory>
+
+#include "codec.hpp"
+#include "stream.hpp"
+
+namespace comp
+{
+    /* Self-describing wrapper around any codec: the header says which codec wrote the rest, so decoding never needs to be told.
+     *
+     * Format:
+     * 1. { magic | version | codec id }, one byte each but the 3-byte magic; version 2 sets `checksum_flag` in the codec id
+     *    when its blocks carry checksums
+     * 2. version 1: the codec's stream (codec::encoder()); version 2: independently decodable blocks (see seekable)
+     */
+    class container
+    {
+    public:
+        static const std::string ext;
+
+        static const size_t header_size = 5;
+        static const uint8_t plain_version = 1;
+        static const uint8_t seekable_version = 2;
+        static const uint8_t checksum_flag = 0x80;
+
+        /* The automatic encoder holds this much input back, and chooses from it: */
+        static constexpr size_t sample_size = 1 << 18;
+
+        /* Blocks of the input looked at by choose(), spread evenly over it: */
+        static constexpr size_t sample_blocks = 8;
+
+        /* The codec most likely to do best on data like `in`, from the order-0 entropy and repeats of a few sampled blocks
+         * (see estimate), in a small fraction of the time of a trial compression:
+         * - incompressible: LZ77, which stores such blocks at memcpy speed
+         * - strings repeat: LZW, which beats every other codec here on text, logs and structured binary
+         * - otherwise (skewed, but no repeats beyond what the skew explains): Huffman
+         */
+        static codec_id choose(std::span<const uint8_t> in);
+
+        /* `out` is overwritten but keeps its capacity. decompress() returns false on corrupt input: */
+        static void compress(std::span<const uint8_t> in, std::vector<uint8_t> &out);
+        static void compress(codec_id, std::span<const uint8_t> in, std::vector<uint8_t> &out);
+        static bool decompress(std::span<const uint8_t> in, std::vector<uint8_t> &out);
+
+        /* Same, a fragment at a time. Without a codec, the encoder chooses from the first `sample_size` bytes.
+         * `stats`, if given, receives the codec (as its codec_id value) once known, and the time taken to choose it: */
+        static std::unique_ptr<stream_coder> encoder(stats * = nullptr);
+        static std::unique_ptr<stream_coder> encoder(codec_id, stats * = nullptr);
+        static std::unique_ptr<stream_coder> decoder(stats * = nullptr);
+
+        static void put_header(std::vector<uint8_t> &out, codec_id, uint8_t version, bool checksums = false);
+
+        /* The codec (and format) a container was written with; false if `in` does not start with a container header: */
+        static bool identify(std::span<const uint8_t> in, codec_id &);
+        static bool identify(std::span<const uint8_t> in, codec_id &, uint8_t &version, bool &checksums);
+    };
+}
+
+#endif
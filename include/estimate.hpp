@@ -0,0 +1,30 @@
+#ifndef ESTIMATE_HPP
+#define ESTIMATE_HPP
+
+#include <cstdint>
+#include <span>
+
+namespace comp
+{
+    /* Quick guesses at how compressible a block is, from a sample of it rather than a trial compression.
+     * The sample is `slices` evenly spaced slices of `slice_size` bytes, or all of a block that is smaller.
+     */
+    class estimate
+    {
+    public:
+        static const size_t slices = 4;
+        static const size_t slice_size = 1024;
+
+        /* Order-0 entropy of the sample, bits per byte: */
+        static double entropy(std::span<const uint8_t>);
+
+        /* Share of sampled positions whose next `length` bytes (8 at most) already occurred in the sample (one probe of a hash table).
+         * 4 shows any repeats; 8 shows strings, as an order-0 source with a skewed distribution rarely repeats that many bytes: */
+        static double match_density(std::span<const uint8_t>, size_t length = 4);
+
+        /* Near-uniform bytes and no repeats: nothing for a coder to gain, the block is better stored as is. */
+        static bool incompressible(std::span<const uint8_t>);
+    };
+}
+
+#endif
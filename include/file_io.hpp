@@ -0,0 +1,165 @@
+#ifndef FILE_IO_HPP
+#define FILE_IO_HPP
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <thread>
+
+#include <sys/types.h>
+
+#include "bounded_queue.hpp"
+
+namespace comp
+{
+    /* Input without per-byte calls: regular files are memory mapped, anything else (pipes, "-" for stdin)
+     * is read with large read() calls. Errors are printed, and reported through the return values / failed().
+     */
+    class input_file
+    {
+    public:
+        static const size_t block_size = 1 << 20;
+
+        input_file() = default;
+        input_file(const input_file &) = delete;
+        input_file &operator=(const input_file &) = delete;
+        ~input_file();
+
+        bool open(const std::string &filename);
+
+        /* Everything not read yet; a pipe is read to its end first: */
+        std::span<const uint8_t> all();
+
+        /* The next `max` bytes, fewer only at the end (empty there). Valid until the next call: */
+        std::span<const uint8_t> next(size_t max = block_size);
+
+        /* Same, copied into `to`; returns how many: */
+        size_t read(uint8_t *to, size_t max);
+
+        /* The next `max` bytes (fewer only at the end), left for the next read. Valid until the next call: */
+        std::span<const uint8_t> peek(size_t max);
+
+        /* Whether the open descriptor `other` is this very file: */
+        bool same_file(int other) const;
+
+        bool mapped() const
+        {
+            return is_mapped;
+        }
+
+        bool failed() const
+        {
+            return error;
+        }
+
+    private:
+        std::string name;
+        int fd = -1;
+
+        bool is_mapped = false;
+        const uint8_t *map = nullptr;
+        size_t map_size = 0;
+        size_t pos = 0;
+
+        /* Regular files only: */
+        dev_t device = 0;
+        ino_t inode = 0;
+
+        /* Pipes only; `ahead` holds what peek() read and the reads have not consumed yet (from `ahead_pos`): */
+        std::vector<uint8_t> buffer, ahead;
+        size_t ahead_pos = 0;
+        bool error = false;
+
+        size_t read_fd(uint8_t *to, size_t size);
+        size_t read_into(uint8_t *to, size_t size);
+    };
+
+    /* Output in large page-aligned blocks; a write() of at least a block's worth goes straight to the file.
+     * When the final size is known, map() sizes the file up front and hands out its mapping instead, so the output is
+     * produced in place. "-" is stdout. Everything reaches the file by close() (also called by the destructor).
+     */
+    class output_file
+    {
+    public:
+        static const size_t buffer_size = 1 << 20;
+
+        output_file() = default;
+        output_file(const output_file &) = delete;
+        output_file &operator=(const output_file &) = delete;
+        ~output_file();
+
+        /* Refuses (after printing why) to overwrite `input`, which may be still mapped and is usually what the output was made from: */
+        bool open(const std::string &filename, const input_file *input = nullptr);
+        bool write(std::span<const uint8_t> data);
+
+        /* Before any write() only. Empty if the output cannot be mapped (pipes); write() it then: */
+        std::span<uint8_t> map(size_t size);
+
+        /* False (after printing why) if anything could not be written: */
+        bool close();
+
+    private:
+        std::string name;
+        int fd = -1;
+
+        uint8_t *buffer = nullptr;
+        size_t buffered = 0;
+
+        uint8_t *mapping = nullptr;
+        size_t map_size = 0;
+        bool error = false;
+
+        bool write_all(const uint8_t *data, size_t size);
+    };
+
+    /* Reads on a thread of its own, up to `depth` blocks ahead of next(), so the disk works while the caller computes.
+     * Mapped input is handed out in place once its pages have been faulted in; pipes are read into recycled buffers.
+     * `in` belongs to the reading thread until this object is gone.
+     */
+    class read_ahead
+    {
+    public:
+        read_ahead(input_file &in, size_t depth = 3, size_t block_size = input_file::block_size);
+        ~read_ahead();
+
+        /* Empty at the end (then check `in.failed()`). Valid until the next call: */
+        std::span<const uint8_t> next();
+
+    private:
+        struct block
+        {
+            std::span<const uint8_t> data;
+            std::vector<uint8_t> storage;
+        };
+
+        bounded_queue<block> ready;
+        bounded_queue<std::vector<uint8_t>> spare;
+        block current;
+        bool ended = false;
+        std::thread thread;
+    };
+
+    /* Writes on a thread of its own: buffers handed over with write() are queued (`depth` at most) and written
+     * while the caller produces the next ones. `out` belongs to the writing thread until finish().
+     */
+    class write_behind
+    {
+    public:
+        write_behind(output_file &out, size_t depth = 3);
+        ~write_behind();
+
+        /* An empty buffer (recycled, so it keeps its capacity) to fill and pass to write(). Blocks while all are queued: */
+        std::vector<uint8_t> buffer();
+        void write(std::vector<uint8_t> &&data);
+
+        /* Waits until everything queued is written: */
+        void finish();
+
+    private:
+        bounded_queue<std::vector<uint8_t>> queued, spare;
+        std::thread thread;
+    };
+}
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef LDPC_HPP
+#define LDPC_HPP
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <span>
+
+namespace comp
+{
+    /* xoshiro256** seeded through splitmix64. Much faster than rand(), and every
+     * instance has its own state, so each thread can own one.
+     */
+    class Random
+    {
+    public:
+        Random(uint64_t seed);
+
+        uint64_t next();
+
+        /* Uniform in [0, bound): */
+        uint32_t below(uint32_t bound);
+
+        /* Uniform in (0, 1]: */
+        double uniform();
+
+        /* Standard normal (Box-Muller): */
+        double normal();
+
+    private:
+        uint64_t s[4];
+    };
+
+    /* Sparse (Tanner graph) form of the parity-check matrix H. Every 1 in H is an edge between a check and a variable (bit).
+     *
+     * Edges are numbered in row order (CSR): the edges of check `c` are `check_ptr[c], ..., check_ptr[c + 1] - 1`,
+     * and `edge_var[e]` is the variable at the other end of edge `e`.
+     *
+     * The same edges, grouped by variable (CSC): `var_edge[var_ptr[v]], ..., var_edge[var_ptr[v + 1] - 1]`
+     * are the edges of variable `v`, and `edge_check[e]` is the check at the other end.
+     */
+    struct tanner_graph
+    {
+        /* Most bits, and most checks, a loaded code may have, so that a corrupt header cannot ask for gigabytes: */
+        static const uint32_t max_size = 1 << 24;
+
+        std::vector<uint32_t> check_ptr, edge_var;
+        std::vector<uint32_t> var_ptr, var_edge, edge_check;
+
+        size_t num_checks() const
+        {
+            return check_ptr.size() - 1;
+        }
+
+        size_t num_bits() const
+        {
+            return var_ptr.size() - 1;
+        }
+
+        size_t num_edges() const
+        {
+            return edge_var.size();
+        }
+
+        /* `checks[c]` lists the variables of check `c`: */
+        void build(uint32_t num_bits, const std::vector<std::vector<uint32_t>> &checks);
+
+        size_t count_4_cycles() const;
+        void print() const;
+
+        /* save() fails on a code load() would refuse, and on a check of degree above 65535, which the format cannot hold: */
+        bool save(const std::string &) const;
+        bool load(const std::string &);
+    };
+
+    /* Quasi-cyclic code: H is a `rows` x `cols` grid of Z x Z blocks (circulants). Block (r, c) is either zero (`shift` negative)
+     * or the identity with its columns rotated by `shift[r * cols + c]`: check `z` of row block `r` meets bit `(z + shift) % Z`
+     * of column block `c`. The base matrix is all that is stored, however large Z gets.
+     */
+    struct qc_code
+    {
+        uint32_t rows = 0, cols = 0, z = 0;
+        std::vector<int32_t> shift;
+
+        size_t num_checks() const
+        {
+            return static_cast<size_t>(rows) * z;
+        }
+
+        size_t num_bits() const
+        {
+            return static_cast<size_t>(cols) * z;
+        }
+
+        /* Edge-level form, checks and bits numbered block by block: */
+        void expand(tanner_graph &) const;
+
+        bool save(const std::string &) const;
+        bool load(const std::string &);
+    };
+
+    /* Systematic encoder, derived from H once (see build()) and cached next to the code.
+     *
+     * Message bit `j` is stored at position `info[j]` of the codeword. The remaining positions are either
+     * `gap` bits, each a bit-packed combination of the message bits (`gap_rows`), or bits resolved by a single
+     * check from bits already known, in `schedule` order (back-substitution over the sparse H).
+     */
+    struct systematic_encoder
+    {
+        std::vector<uint32_t> info;
+        std::vector<uint32_t> gap;
+        std::vector<uint64_t> gap_rows;
+        size_t row_words = 0;
+
+        /* {check, variable} */
+        std::vector<std::pair<uint32_t, uint32_t>> schedule;
+
+        size_t k() const
+        {
+            return info.size();
+        }
+
+        void build(const tanner_graph &);
+
+        /* `message` holds k bits, `frame` n bits, both MSB first: */
+        void encode(const tanner_graph &, const uint8_t *message, uint8_t *frame) const;
+        void extract(const uint8_t *frame, uint8_t *message) const;
+
+        /* Encodes 64 * `words` messages at once, in the bit-sliced layout of ldpc::gallager_b_decode_sliced():
+         * `message` holds k * `words` words, `bits` receives n * `words`. */
+        void encode_sliced(const tanner_graph &, const std::vector<uint64_t> &message, std::vector<uint64_t> &bits, size_t words) const;
+
+        /* Both take the code the encoder was built from; load() fails if the file was built from another: */
+        bool save(const std::string &, const tanner_graph &) const;
+        bool load(const std::string &, const tanner_graph &);
+    };
+
+    /* Summary of a decoded frame stream: */
+    struct frame_stats
+    {
+        size_t frames = 0;
+        size_t converged = 0;
+
+        /* `iterations[i]` frames needed i iterations: */
+        std::vector<size_t> iterations;
+    };
+
+    /* One point of a BER/FER simulation: */
+    struct sim_point
+    {
+        double p = 0;
+        size_t frames = 0;
+        size_t frame_errors = 0;
+        size_t bit_errors = 0;
+        size_t iterations = 0;
+        double seconds = 0;
+
+        /* Erasure channel: frames that needed Gaussian elimination after peeling */
+        size_t eliminations = 0;
+    };
+
+    class ldpc
+    {
+    public:
+        static const std::string ext;
+
+        /* The constructions below leave the code untouched and return false if they cannot build it from the given parameters. */
+
+        /* Regular (w_c, w_r) Gallager code: `w_c` stacked blocks of `n / w_r` checks, each block a column permutation of the first.
+         * `n` has to be a multiple of `w_r`. */
+        static bool gallager(tanner_graph &, uint32_t n, uint32_t w_r, uint32_t w_c, uint64_t seed);
+
+        /* Progressive edge growth: every variable gets `w_c` edges, each to the least used check outside its neighbourhood
+         * of up to `depth` levels. Any depth avoids 4-cycles as long as the code is sparse enough to allow it.
+         * Fails if a variable runs out of checks it is not yet connected to, i.e. `w_c` > `m`.
+         */
+        static bool peg(tanner_graph &, uint32_t n, uint32_t m, uint32_t w_c, uint64_t seed, uint32_t depth = 2);
+
+        /* Random quasi-cyclic code: every column block gets `w_c` circulants, in the least used row blocks, with shifts
+         * redrawn (a few times at most) while they would close a 4-cycle. `w_c` can be at most `rows`.
+         */
+        static bool quasi_cyclic(qc_code &, uint32_t rows, uint32_t cols, uint32_t z, uint32_t w_c, uint64_t seed);
+
+        /* If `iterations` is given, it receives the number of iterations run; 0 means the received frame was already a codeword.
+         *
+         * `layers` > 1 selects the layered schedule: the checks are split into that many consecutive groups (for a Gallager code,
+         * its `w_c` blocks; for a quasi-cyclic one, its row blocks), and each iteration goes through them in order, flipping bits
+         * that fail one of the layer's checks and applying the flips before the next layer. Later layers see the corrections
+         * of earlier ones, so fewer iterations are needed. One layer is the flooding schedule.
+         */
+        static std::vector<int> gallager_b_decode(const tanner_graph &, std::vector<int> received, int max_iterations = 10, int *iterations = nullptr,
+                                                  uint32_t layers = 1);
+
+        /* Bit-sliced Gallager B, decodes 64 * `words` frames at once. Bit `i` of frame `f` is bit `f % 64` of `bits[i * words + f / 64]`.
+         * Decodes in place and returns the convergence mask (zero syndrome), one bit per frame in the same layout.
+         * Any `words` works; 4 lets the compiler use 256-bit vectors where available.
+         * If `iterations` is given, it receives the number of iterations each frame needed to converge (or ran, if it did not).
+         * `layers` as in gallager_b_decode().
+         */
+        static std::vector<uint64_t> gallager_b_decode_sliced(const tanner_graph &, std::vector<uint64_t> &bits, size_t words, int max_iterations = 10,
+                                                              std::vector<uint8_t> *iterations = nullptr, uint32_t layers = 1);
+
+        /* Decode a stream of received frames, each `n` bits MSB first, padded to whole bytes. Batches are decoded on `threads` threads
+         * (0 means one per core) while the calling thread keeps reading and writing; decoded frames are written in input order.
+         * One line per frame (`frame,iterations,converged`) goes to `report`, if given.
+         */
+        static frame_stats decode_frames(const tanner_graph &, std::istream &in, std::ostream &out, std::ostream *report = nullptr,
+                                         size_t threads = 0, int max_iterations = 10, uint32_t layers = 1);
+
+        /* Same, in memory, on the calling thread. `out` is overwritten; a trailing partial frame is dropped: */
+        static frame_stats decode_frames(const tanner_graph &, std::span<const uint8_t> in, std::vector<uint8_t> &out, int max_iterations = 10,
+                                         uint32_t layers = 1);
+
+        /* Encode a stream as consecutive k-bit messages (MSB first, the last one padded with zeros) into frames
+         * in the decode_frames() layout. Returns the number of frames written. */
+        static size_t encode_frames(const tanner_graph &, const systematic_encoder &, std::istream &in, std::ostream &out);
+        static size_t encode_frames(const tanner_graph &, const systematic_encoder &, std::span<const uint8_t> in, std::vector<uint8_t> &out);
+
+        /* Binary symmetric channel: flip every bit independently with probability `p`. */
+        static void bsc(std::vector<uint64_t> &bits, double p, Random &);
+
+        /* Monte Carlo simulation over a BSC with crossover probability `p`, sending the all-zero codeword (the code is linear).
+         * Runs on `threads` threads (0 means one per core), each with its own generator, until `target_errors` frame errors
+         * or `max_frames` frames.
+         */
+        static sim_point simulate(const tanner_graph &, double p, size_t target_errors, size_t max_frames, uint64_t seed,
+                                  size_t threads = 0, int max_iterations = 10, uint32_t layers = 1);
+
+        /* Same, over a binary-input AWGN channel at `ebn0_db` (design rate 1 - m / n). Min-sum gets the quantized samples as LLRs.
+         * Gallager B gets the hard decisions of the very same samples, the sign of each one before quantization: to it, the channel
+         * is a BSC with p = Q(sqrt(2 * rate * Eb/N0)), and the reliabilities are lost. `decoders` selects which of the two run;
+         * the simulation goes on until each of them has `target_errors`. Returns {min-sum, Gallager B}, with `p` set to `ebn0_db`,
+         * `seconds` counting only time spent in each decoder, summed over threads, and no frames for a decoder that did not run.
+         */
+        static const unsigned awgn_min_sum = 0x1, awgn_gallager_b = 0x2;
+        static std::pair<sim_point, sim_point> simulate_awgn(const tanner_graph &, double ebn0_db, size_t target_errors, size_t max_frames,
+                                                             uint64_t seed, size_t threads = 0, int max_iterations = 10,
+                                                             unsigned decoders = awgn_min_sum | awgn_gallager_b);
+
+        /* Binary erasure channel over symbols of `symbol_size` bytes: random codewords from `enc`, each symbol lost with probability `p`,
+         * recovered with erasure_decode(). `bit_errors` counts symbols left erased, `seconds` only time spent decoding.
+         */
+        static sim_point simulate_bec(const tanner_graph &, const systematic_encoder &, double p, size_t symbol_size, size_t target_errors,
+                                      size_t max_frames, uint64_t seed, size_t threads = 0);
+
+        /* Quasi-cyclic min-sum alone, over the same channel: */
+        static sim_point simulate_awgn(const qc_code &, double ebn0_db, size_t target_errors, size_t max_frames,
+                                       uint64_t seed, size_t threads = 0, int max_iterations = 10);
+
+        /* Normalized min-sum over int8 LLRs (positive means 0), same conventions as gallager_b_decode(). Runs the batch kernel below
+         * with the frame in one lane and a converged frame in the others: each iteration costs what a full batch does, so decode
+         * many frames through min_sum_decode_batch(). */
+        static std::vector<int> min_sum_decode(const tanner_graph &, const std::vector<int8_t> &llr, int max_iterations = 10, int *iterations = nullptr);
+
+        /* Same decoder on a quasi-cyclic code, one frame at a time. Works a whole circulant at once: messages live in Z-long rows,
+         * and moving them between bits and checks is a rotation (two contiguous copies), so every inner loop runs over Z contiguous lanes.
+         * Gives the same decisions as min_sum_decode() on the expanded graph.
+         */
+        static std::vector<int> min_sum_decode(const qc_code &, const std::vector<int8_t> &llr, int max_iterations = 10, int *iterations = nullptr);
+
+        /* Min-sum over `min_sum_lanes` frames at once, one SIMD lane per frame: bit `i` of frame `f` is at `[i * min_sum_lanes + f]`,
+         * `hard` receives 0/1 decisions. Returns the convergence mask; `iterations` (optional) gets a count per frame.
+         * Uses AVX2 or SSE4.1 when the CPU has them, plain C++ otherwise.
+         */
+        static const size_t min_sum_lanes = 32;
+        static uint32_t min_sum_decode_batch(const tanner_graph &, const int8_t *llr, uint8_t *hard, int max_iterations = 10, uint8_t *iterations = nullptr);
+
+        /* Erasure decoding. Symbol `v` is `symbol_size` bytes at `symbols + v * symbol_size`, and every check of H holds bytewise
+         * (8 * `symbol_size` interleaved codewords, as produced by systematic_encoder::encode_sliced() with `symbol_size / 8` words).
+         * Erased symbols are flagged in `erased`; recovered ones are written and unflagged.
+         * Peels degree-1 checks first, O(edges) symbol XORs, then solves the stopping set left over by Gaussian elimination
+         * (`eliminated`, if given, says whether it was needed). Returns the number of symbols still erased.
+         */
+        static size_t erasure_decode(const tanner_graph &, uint8_t *symbols, size_t symbol_size, std::vector<uint8_t> &erased, bool *eliminated = nullptr);
+
+        /* Conversion between frames of one bit per int and the bit-sliced layout: */
+        static void slice(const std::vector<std::vector<int>> &frames, std::vector<uint64_t> &bits, size_t words);
+        static void unslice(const std::vector<uint64_t> &bits, size_t words, std::vector<std::vector<int>> &frames);
+    };
+}
+
+#endif
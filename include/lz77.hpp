@@ -0,0 +1,49 @@
+#ifndef LZ77_HPP
+#define LZ77_HPP
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <memory>
+
+#include "stream.hpp"
+
+namespace comp
+{
+    class stats;
+
+    class lz77
+    {
+    public:
+        static const std::string ext;
+
+        /* Window sizes written by encode(); both fit the one-byte fields of the format: */
+        static constexpr uint8_t search_buffer_size = 226;
+        static constexpr uint8_t lookahead_buffer_size = 24;
+
+        /*
+         * Format:
+         * 1. { search buffer size | lookahead buffer size }, one byte each
+         * 2. { start position | length | next byte }, one byte each, once per token
+         *
+         * Input is coded in blocks of `block_size`; matches reach back into the previous block, but not forward into the next.
+         * A block the tokens would not make smaller is stored instead: { stored | size - 1, 16-bit big endian } { block },
+         * `stored` being a start position no search buffer reaches.
+         *
+         * `out` is overwritten but keeps its capacity. decode() returns false on corrupt input.
+         * `stats`, if given, receives the token counts: literals, matches and their length, positions searched, stored blocks.
+         */
+        static void encode(std::span<const uint8_t> in, std::vector<uint8_t> &out, stats * = nullptr);
+        static bool decode(std::span<const uint8_t> in, std::vector<uint8_t> &out);
+
+        static const size_t block_size = 1 << 16;
+        static constexpr uint8_t stored = 0xFF;
+
+        /* Same, a fragment at a time. The encoder holds a block and the search buffer before it, the decoder just the search buffer: */
+        static std::unique_ptr<stream_coder> encoder(stats * = nullptr);
+        static std::unique_ptr<stream_coder> decoder();
+    };
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef LZW_HPP
+#define LZW_HPP
+
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <span>
+#include <memory>
+
+#include "stream.hpp"
+
+namespace comp
+{
+    /* What the encoder ended up with: */
+    struct lzw_stats
+    {
+        uint8_t word_width = 0;
+        size_t maxsize = 0;
+        size_t count = 0;
+        size_t resets = 0;
+        size_t stored_blocks = 0;
+    };
+
+    class lzw
+    {
+    public:
+        static const std::string ext;
+
+        enum status
+        {
+            ok = 0,
+            corrupt,
+
+            /* No implicit-dictionary header, so not an LZW file: */
+            unknown_format
+        };
+
+        /* Implicit-dictionary format (standard LZW, variable width codes). Streams: reads `in` in fixed-size chunks,
+         * writes as it goes, so memory does not depend on the input size. */
+        static lzw_stats encode(std::istream &in, std::ostream &out);
+        static status decode(std::istream &in, std::ostream &out);
+
+        /* Same, through the file layer (mapped input, block output); `timing`, if given, receives the stage times: */
+        static lzw_stats encode(input_file &in, output_file &out, stats *timing = nullptr);
+        static status decode(input_file &in, output_file &out, stats *timing = nullptr);
+
+        /* Same, in memory. `out` is overwritten but keeps its capacity: */
+        static lzw_stats encode(std::span<const uint8_t> in, std::vector<uint8_t> &out);
+        static status decode(std::span<const uint8_t> in, std::vector<uint8_t> &out);
+
+        /* Same, a fragment at a time. `stats`, if given, is filled in once the encoder is finished: */
+        static std::unique_ptr<stream_coder> encoder(lzw_stats *stats = nullptr);
+        static std::unique_ptr<stream_coder> decoder();
+    };
+}
+
+#endif
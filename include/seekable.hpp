@@ -0,0 +1,90 @@
+#ifndef SEEKABLE_HPP
+#define SEEKABLE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <memory>
+
+#include "codec.hpp"
+#include "stream.hpp"
+
+namespace comp
+{
+    class stats;
+
+    /* Container (version 2) for reading a range out of the middle of a large file without decoding what comes before it.
+     * The input is cut into blocks of a fixed size (the last may be shorter), each compressed on its own, and an index of
+     * where they are closes the file.
+     *
+     * Format, integers little endian:
+     * 1. container header { magic | 2 | codec id }
+     * 2. { compressed size (32 bits) | CRC32C of the uncompressed block (32 bits, with checksums only) | block, as codec::compress()
+     *    writes it }, once per block
+     * 3. { 0 (32 bits) }, so a stream decoder knows the blocks have ended
+     * 4. index: { offset of the block's size field (64 bits) | uncompressed size (32 bits) }, once per block
+     * 5. { index offset (64 bits) | block count (64 bits) | end magic "CMPI" }
+     */
+    class seekable
+    {
+    public:
+        static const size_t default_block_size = 1 << 20;
+
+        /* Blocks are held in memory whole, and decoded whole; below 4 GiB. With `checksums`, every block is checked
+         * (see checksum) as it is decoded, by either decoder: */
+        static std::unique_ptr<stream_coder> encoder(codec_id, size_t block_size = default_block_size, bool checksums = false,
+                                                     stats * = nullptr);
+
+        /* The codec is chosen from the first block (see container::choose): */
+        static std::unique_ptr<stream_coder> encoder(size_t block_size = default_block_size, bool checksums = false, stats * = nullptr);
+
+        /* Everything after the container header, a block at a time (container::decoder() hands version 2 over to it): */
+        static std::unique_ptr<stream_coder> decoder(codec_id, bool checksums = false);
+
+        /* Random access to a whole seekable container, e.g. a mapped file (input_file::all()), which must outlive it: */
+        class reader
+        {
+        public:
+            /* False if `file` is not a complete seekable container (the blocks themselves are checked as they are read): */
+            bool open(std::span<const uint8_t> file);
+
+            codec_id codec() const
+            {
+                return id;
+            }
+
+            /* Uncompressed: */
+            uint64_t size() const
+            {
+                return starts.back();
+            }
+
+            size_t blocks() const
+            {
+                return offsets.size() - 1;
+            }
+
+            bool checksums() const
+            {
+                return sums;
+            }
+
+            /* Appends bytes [offset, offset + length) of the uncompressed data to `out`, less past its end. Finds the first
+             * block by binary search and decodes only the blocks the range touches. False if one of them is corrupt
+             * (or fails its checksum): */
+            bool read(uint64_t offset, uint64_t length, std::vector<uint8_t> &out);
+
+        private:
+            std::span<const uint8_t> file;
+            codec_id id = codec_id::huffman;
+            bool sums = false;
+
+            /* One more than blocks(): compressed offsets of the size fields, and uncompressed offsets, each ending at the end: */
+            std::vector<uint64_t> offsets{0}, starts{0};
+
+            std::vector<uint8_t> decoded;
+        };
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+namespace comp
+{
+    /* What a tool reports with --stats (text) or --stats=json: time per stage, from a monotonic clock, and named counters.
+     * Everything that records into it takes a `stats *` which is null when the option is off, and then does nothing:
+     * no clock is read, and counters kept in locals are handed over once, at the end of a run.
+     */
+    class stats
+    {
+    public:
+        enum format
+        {
+            off = 0,
+            text,
+            json
+        };
+
+        /* True if `arg` is "--stats" or "--stats=json": */
+        static bool parse(const std::string &arg, format &);
+
+        /* Null for `off`, so get() can be passed on as is: */
+        static std::unique_ptr<stats> make(format);
+
+        /* Times a stage until stop() or the end of its scope. A stage that runs more than once adds up: */
+        class timer
+        {
+        private:
+            timer();
+
+        public:
+            timer(stats *, const char *stage);
+            timer(const timer &) = delete;
+            timer &operator=(const timer &) = delete;
+            ~timer();
+
+            void stop();
+
+        private:
+            stats *owner;
+            const char *stage;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        void add_time(const std::string &stage, double seconds);
+        void set(const std::string &counter, double value);
+
+        void print(std::ostream &) const;
+
+    private:
+        stats(format);
+
+        const format output;
+        std::vector<std::pair<std::string, double>> stages, counters;
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <iostream>
+
+namespace comp
+{
+    class input_file;
+    class output_file;
+    class stats;
+
+    /* Incremental coder, zlib style: input is pushed in fragments of any size, output is pulled into the caller's buffer.
+     * Everything the coder needs between fragments lives in the object, so one can be parked per connection.
+     * Memory is bounded: feed() stops taking input once `output_limit` bytes are waiting to be drained.
+     *
+     * Every call returns what the caller has to do next:
+     * need_input - feed() more, or finish() at the end of the input; output may be drained at any point
+     * output_full - drain() first; feed() then takes the rest of its input again (`consumed` says how far it got)
+     * done - finished and drained
+     * corrupt - decoders only, nothing more will come out
+     */
+    class stream_coder
+    {
+    public:
+        enum status
+        {
+            need_input = 0,
+            output_full,
+            done,
+            corrupt
+        };
+
+        static const size_t output_limit = 1 << 16;
+
+        virtual ~stream_coder() = default;
+
+        virtual status feed(std::span<const uint8_t> in, size_t &consumed) = 0;
+
+        /* End of input; queues the rest of the output: */
+        virtual status finish() = 0;
+
+        /* Copies pending output into `out`, `written` bytes of it: */
+        status drain(std::span<uint8_t> out, size_t &written);
+
+        /* All of the input in one go, appended to `out` / written to `out` as it comes. done or corrupt.
+         * The file version records, in `stats` if given, time spent coding and waiting on either file: */
+        status run(std::span<const uint8_t> in, std::vector<uint8_t> &out);
+        status run(std::istream &in, std::ostream &out);
+        status run(input_file &in, output_file &out, stats * = nullptr);
+
+    protected:
+        std::vector<uint8_t> output;
+        size_t drained = 0;
+        bool finished = false;
+        bool failed = false;
+
+        bool full() const
+        {
+            return output.size() - drained >= output_limit;
+        }
+
+        /* Pending output comes first; `otherwise` once it is drained: */
+        status pending_or(status otherwise) const
+        {
+            if (failed)
+            {
+                return corrupt;
+            }
+            return (output.size() > drained) ? output_full : otherwise;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace comp
+{
+    /* Fixed number of worker threads taking tasks from a shared FIFO queue. */
+    class ThreadPool
+    {
+    private:
+        ThreadPool();
+
+    public:
+        /* 0 means one thread per core: */
+        ThreadPool(size_t);
+        ~ThreadPool();
+
+        std::future<void> submit(std::function<void()>);
+
+        size_t size() const;
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::packaged_task<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool stop = false;
+
+        void _run();
+    };
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <cmath>
 
 #include "common.hpp"
+#include "stats.hpp"
 
 int main(int argc, char *argv[])
 {
@@ -17,11 +18,23 @@ int main(int argc, char *argv[])
     }
 
     const std::string filename(argv[1]);
+    comp::stats::format format = comp::stats::off;
+
+    if (argc > 2 && !comp::stats::parse(argv[2], format))
+    {
+        std::cout << "Unknown option" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::unique_ptr<comp::stats> stats = comp::stats::make(format);
 
     /* Initialized to 0 by default: */
     std::map<uint8_t, double> prob;
 
-    comp::common::calc_prob(filename, prob);
+    if (!comp::common::calc_prob(filename, prob, stats.get()))
+    {
+        return EXIT_FAILURE;
+    }
 
     double entropy = 0.0;
 
@@ -35,5 +48,11 @@ int main(int argc, char *argv[])
 
     std::cout << "Entropy: " << entropy << std::endl;
 
+    if (stats)
+    {
+        stats->set("entropy_bits", entropy);
+        stats->print(std::cout);
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <sstream>
 
 #include "common.hpp"
+#include "stats.hpp"
 
 int main(int argc, char *argv[])
 {
@@ -20,14 +21,29 @@ int main(int argc, char *argv[])
     }
 
     const std::string filename(argv[2]);
+    comp::stats::format format = comp::stats::off;
+
+    if (argc > 3 && !comp::stats::parse(argv[3], format))
+    {
+        std::cout << "Unknown option" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::unique_ptr<comp::stats> stats = comp::stats::make(format);
 
     if (std::string(argv[1]) == "-d")
     {
-        comp::common::decode(filename);
+        if (!comp::common::decode(filename, stats.get()))
+        {
+            return EXIT_FAILURE;
+        }
     }
     else if (std::string(argv[1]) == "-e")
     {
-        comp::common::shannon_fano_encode(filename);
+        if (!comp::common::shannon_fano_encode(filename, stats.get()))
+        {
+            return EXIT_FAILURE;
+        }
     }
     else
     {
@@ -35,5 +51,10 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    if (stats)
+    {
+        stats->print(std::cout);
+    }
+
     return EXIT_SUCCESS;
 }
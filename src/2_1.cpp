@@ -1,187 +1,564 @@
-#include <iostream>
-#include <cstdlib>
-#include <cstdint>
-#include <ctime>
-#include <vector>
-
-const uint8_t n = 15;
-const uint8_t n_k = 9;
-
-const uint8_t w_r = 5;
-const uint8_t w_c = 3;
-
-static_assert(n % w_r == 0, "Not divisible");
-
-const uint8_t m = (n / w_r) * w_c;
-
-uint8_t H[m][n];
-
-const double th = 0.5;
-
-void print_matrix()
-{
-    for (int i = 0; i < m; i++)
-    {
-        for (int j = 0; j < n; j++)
-        {
-            std::cout << static_cast<int>(H[i][j]) << " ";
-        }
-        std::cout << std::endl;
-    }
-}
-
-void copy_column(int i_dest, int j_dest, int i_src, int j_src, int colspan)
-{
-    if (i_src + colspan > m || i_dest + colspan > m)
-    {
-        std::cerr << "Colsize exceeded" << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < colspan; i++)
-    {
-        H[i_dest + i][j_dest] = H[i_src + i][j_src];
-    }
-}
-
-std::vector<int> gallager_b_decode(std::vector<int> received, int max_iterations = 10)
-{
-    int num_bits = received.size();
-    int num_checks = m;
-
-    std::vector<int> decoded = received;
-
-    for (int iteration = 0; iteration < max_iterations; ++iteration)
-    {
-        std::vector<int> checks_count(num_bits, 0);
-
-        for (int check = 0; check < num_checks; ++check)
-        {
-            int parity = 0;
-            for (int bit = 0; bit < num_bits; ++bit)
-            {
-                if (H[check][bit] == 1)
-                {
-                    parity ^= decoded[bit];
-                }
-            }
-            if (parity != 0)
-            {
-                for (int bit = 0; bit < num_bits; ++bit)
-                {
-                    if (H[check][bit] == 1)
-                    {
-                        checks_count[bit]++;
-                    }
-                }
-            }
-        }
-
-        /* Threshold & bit flip:  */
-        bool any_flipped = false;
-        for (int bit = 0; bit < num_bits; ++bit)
-        {
-            if (checks_count[bit] > th * num_checks)
-            {
-                decoded[bit] ^= 1;
-                any_flipped = true;
-            }
-        }
-
-        /* Nothing left over to rectify, end: */
-        if (!any_flipped)
-        {
-            break;
-        }
-    }
-
-    return decoded;
-}
-
-int main(int argc, char *argv[])
-{
-    for (auto row : H)
-    {
-        for (uint8_t i; i < n; i++)
-        {
-            row[i] = 0;
-        }
-    }
-
-    /*
-    Write 1s:
-
-    111........0
-    0....111...0
-    0........111
-    ____________
-    ...
-
-    */
-    for (uint8_t i = 0; i < n / w_r; i++)
-    {
-        for (uint8_t j = i * w_r; j < (i + 1) * w_r; j++)
-        {
-            H[i][j] = 1;
-        }
-    }
-
-    /*     print_matrix();
-
-        std::cout << "===================" << std::endl; */
-
-    /* Seed: */
-    srand(492018);
-
-    for (int i = 1; i < w_c; i++)
-    {
-        uint8_t idx_shuffled[n];
-
-        for (int j = 0; j < n; j++)
-        {
-            idx_shuffled[j] = j;
-        }
-
-        /* Permutations:
-         0  1  2  3  4  5  6  7  8  9 10 11 12 13 14
-
-                        |
-                        | (rand)
-                        v
-
-         7 12  3 13  1  0 14 11  4  9  8  6  2 10  5
-        */
-        for (int j = 0; j < n * n; j++)
-        {
-            int p = rand() % n;
-            int q = rand() % n;
-
-            auto r = idx_shuffled[p];
-            idx_shuffled[p] = idx_shuffled[q];
-            idx_shuffled[q] = r;
-        }
-
-        for (int j = 0; j < n; j++)
-        {
-            int dest_row = i * (n / w_r);
-            copy_column(dest_row, j, 0, idx_shuffled[j], n/w_r);
-        }
-    }
-
-    /* Matrix H: */
-    print_matrix();
-
-    std::cout << "===================" << std::endl;
-
-    std::vector<int> received = {1, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 1, 1, 0};
-
-    std::vector<int> decoded = gallager_b_decode(received);
-
-    for (int bit : decoded)
-    {
-        std::cout << bit << " ";
-    }
-    std::cout << std::endl;
-
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <charconv>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "ldpc.hpp"
+#include "stats.hpp"
+
+/* Default (demo) code: */
+const uint32_t n = 15;
+
+const uint32_t w_r = 5;
+const uint32_t w_c = 3;
+
+const uint64_t seed = 492018;
+
+/* Codes up to this length are printed in full: */
+const uint32_t print_limit = 64;
+
+/* Decoded frames, and the per-frame report, are written next to the input: */
+const std::string decoded_ext = ".dec";
+const std::string report_ext = ".csv";
+
+/* The systematic encoder of a loaded code is cached next to it: */
+const std::string encoder_ext = ".enc";
+
+/* Erasure simulations lose whole blocks of this many bytes: */
+const size_t erasure_symbol_size = 512;
+
+/* False unless all of `arg` is a number: */
+template <typename T>
+bool parse_number(const char *arg, T &value)
+{
+    const char *end = arg + std::strlen(arg);
+    const auto [last, error] = std::from_chars(arg, end, value);
+
+    return error == std::errc() && last == end && last != arg;
+}
+
+/* `args` holds the first, last and number of points of a sweep; a `probability` has to lie in [0, 1]: */
+bool parse_sweep(char *args[], double &first, double &last, size_t &points, bool probability)
+{
+    if (!parse_number(args[0], first) || !parse_number(args[1], last) || !parse_number(args[2], points))
+    {
+        return false;
+    }
+
+    return std::isfinite(first) && std::isfinite(last) && first <= last && points > 0 && (!probability || (first >= 0 && last <= 1));
+}
+
+void usage()
+{
+    std::cout << "Usage: [-g <n> <w_r> <w_c> [seed] | -p <n> <m> <w_c> [seed] | -q <row blocks> <column blocks> <Z> <w_c> [seed] | -l <file>] [-s <file>]" << std::endl;
+    std::cout << "       [-c <file> | -d <frames file> | -m <p min> <p max> <points> | -a <Eb/N0 min> <Eb/N0 max> <points> [-t <target FER>] | -b <p min> <p max> <points> [-e <frame errors>] [-f <max frames>]] [-j <threads>] [-i <max iterations>] [-r [layers]] [--stats[=json]]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    comp::tanner_graph g;
+    comp::qc_code qc;
+    std::string save_filename;
+    std::string frames_filename;
+    std::string code_filename;
+    std::string encode_filename;
+    size_t threads = 0;
+    size_t sim_points = 0;
+    bool awgn = false, bec = false;
+    double sim_p_min = 0, sim_p_max = 0;
+
+    /* With -a: instead of a sweep, each decoder's lowest Eb/N0 in [min, max] reaching this FER, over `sim_points` bisection steps: */
+    double target_fer = 0;
+    size_t target_errors = 100;
+    size_t max_frames = 1000000;
+    int max_iterations = 10;
+    comp::stats::format format = comp::stats::off;
+
+    /* Layered Gallager B: the row blocks of the code, if it has any (0), or an explicit count: */
+    bool layered = false;
+    uint32_t layers = 0, code_layers = 0;
+    bool demo = true;
+
+    bool valid = true;
+
+    for (int i = 1; i < argc && valid; i++)
+    {
+        const std::string arg(argv[i]);
+        const int left = argc - i - 1;
+
+        if (arg == "-g" && left >= 3)
+        {
+            uint32_t code_n, code_w_r, code_w_c;
+            uint64_t code_seed = seed;
+
+            valid = parse_number(argv[i + 1], code_n) && parse_number(argv[i + 2], code_w_r) && parse_number(argv[i + 3], code_w_c);
+            i += 3;
+
+            if (valid && left >= 4 && argv[i + 1][0] != '-')
+            {
+                valid = parse_number(argv[++i], code_seed);
+            }
+
+            if (!valid)
+            {
+                break;
+            }
+
+            if (!comp::ldpc::gallager(g, code_n, code_w_r, code_w_c, code_seed))
+            {
+                std::cerr << "No Gallager code: n has to be a multiple of w_r" << std::endl;
+                return EXIT_FAILURE;
+            }
+            code_layers = code_w_c;
+            demo = false;
+        }
+        else if (arg == "-p" && left >= 3)
+        {
+            uint32_t code_n, code_m, code_w_c;
+            uint64_t code_seed = seed;
+
+            valid = parse_number(argv[i + 1], code_n) && parse_number(argv[i + 2], code_m) && parse_number(argv[i + 3], code_w_c);
+            i += 3;
+
+            if (valid && left >= 4 && argv[i + 1][0] != '-')
+            {
+                valid = parse_number(argv[++i], code_seed);
+            }
+
+            if (!valid)
+            {
+                break;
+            }
+
+            if (!comp::ldpc::peg(g, code_n, code_m, code_w_c, code_seed))
+            {
+                std::cerr << "No PEG code: too dense, a variable has no free check left" << std::endl;
+                return EXIT_FAILURE;
+            }
+            demo = false;
+        }
+        else if (arg == "-q" && left >= 4)
+        {
+            uint32_t rows, cols, z, code_w_c;
+            uint64_t code_seed = seed;
+
+            valid = parse_number(argv[i + 1], rows) && parse_number(argv[i + 2], cols) && parse_number(argv[i + 3], z) &&
+                    parse_number(argv[i + 4], code_w_c);
+            i += 4;
+
+            if (valid && left >= 5 && argv[i + 1][0] != '-')
+            {
+                valid = parse_number(argv[++i], code_seed);
+            }
+
+            if (!valid)
+            {
+                break;
+            }
+
+            if (!comp::ldpc::quasi_cyclic(qc, rows, cols, z, code_w_c, code_seed))
+            {
+                std::cerr << "No quasi-cyclic code: Z has to be positive and w_c at most the row blocks" << std::endl;
+                return EXIT_FAILURE;
+            }
+            qc.expand(g);
+            code_layers = qc.rows;
+            demo = false;
+        }
+        else if (arg == "-l" && left >= 1)
+        {
+            code_filename = argv[++i];
+
+            /* Either a base matrix or a full graph: */
+            if (qc.load(code_filename))
+            {
+                qc.expand(g);
+                code_layers = qc.rows;
+            }
+            else if (!g.load(code_filename))
+            {
+                std::cerr << "Error loading code " << code_filename << std::endl;
+                return EXIT_FAILURE;
+            }
+            demo = false;
+        }
+        else if (arg == "-s" && left >= 1)
+        {
+            save_filename = argv[++i];
+        }
+        else if (arg == "-c" && left >= 1)
+        {
+            encode_filename = argv[++i];
+        }
+        else if (arg == "-d" && left >= 1)
+        {
+            frames_filename = argv[++i];
+        }
+        else if ((arg == "-m" || arg == "-a" || arg == "-b") && left >= 3)
+        {
+            /* Eb/N0 is in dB, the others are probabilities: */
+            valid = parse_sweep(argv + i + 1, sim_p_min, sim_p_max, sim_points, arg != "-a");
+            awgn = (arg == "-a");
+            bec = (arg == "-b");
+            i += 3;
+        }
+        else if (arg == "-t" && left >= 1)
+        {
+            valid = parse_number(argv[++i], target_fer) && target_fer > 0 && target_fer < 1;
+        }
+        else if (arg == "-e" && left >= 1)
+        {
+            valid = parse_number(argv[++i], target_errors) && target_errors > 0;
+        }
+        else if (arg == "-f" && left >= 1)
+        {
+            valid = parse_number(argv[++i], max_frames) && max_frames > 0;
+        }
+        else if (arg == "-j" && left >= 1)
+        {
+            valid = parse_number(argv[++i], threads);
+        }
+        else if (arg == "-i" && left >= 1)
+        {
+            /* Iteration counts are reported per frame in a single byte: */
+            valid = parse_number(argv[++i], max_iterations) && max_iterations >= 0 && max_iterations <= 255;
+        }
+        else if (arg == "-r")
+        {
+            layered = true;
+            layers = 0;
+
+            if (left >= 1 && argv[i + 1][0] != '-')
+            {
+                valid = parse_number(argv[++i], layers);
+            }
+        }
+        else if (!comp::stats::parse(arg, format))
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (demo)
+    {
+        comp::ldpc::gallager(g, n, w_r, w_c, seed);
+        code_layers = w_c;
+        demo = frames_filename.empty() && encode_filename.empty() && sim_points == 0;
+    }
+
+    if (!save_filename.empty() && !(qc.z ? qc.save(save_filename) : g.save(save_filename)))
+    {
+        std::cerr << "Error saving code " << save_filename << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!layered)
+    {
+        layers = 1;
+    }
+    else if (layers == 0 && (layers = code_layers) == 0)
+    {
+        std::cerr << "The code has no row blocks, give the number of layers" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    /* Keep the CSV output of a simulation clean: */
+    std::ostream &info = sim_points ? std::cerr : std::cout;
+
+    info << "n: " << g.num_bits() << ", m: " << g.num_checks() << ", edges: " << g.num_edges() << std::endl;
+    info << "4-cycles: " << g.count_4_cycles() << std::endl;
+
+    if (layers > 1)
+    {
+        info << "Layers: " << layers << std::endl;
+    }
+
+    if (qc.z)
+    {
+        info << "Circulants: " << qc.rows << " x " << qc.cols << ", Z: " << qc.z << std::endl;
+    }
+
+    /* Encoding and decoding of frame files only; the simulations report their own figures: */
+    const std::unique_ptr<comp::stats> stats = comp::stats::make(format);
+    comp::systematic_encoder enc;
+
+    auto build_encoder = [&]()
+    {
+        comp::stats::timer build(stats.get(), "encoder build");
+
+        if (code_filename.empty() || !enc.load(code_filename + encoder_ext, g))
+        {
+            enc.build(g);
+
+            if (!code_filename.empty() && !enc.save(code_filename + encoder_ext, g))
+            {
+                std::cerr << "Error saving encoder " << code_filename + encoder_ext << std::endl;
+            }
+        }
+    };
+
+    if (!encode_filename.empty())
+    {
+        build_encoder();
+
+        const std::string out_filename = encode_filename + comp::ldpc::ext;
+
+        std::ifstream in(encode_filename, std::ios::binary);
+        std::ofstream out(out_filename, std::ios::binary);
+
+        if (!in)
+        {
+            std::cerr << "Error opening file " << encode_filename << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!out)
+        {
+            std::cerr << "Error opening file " << out_filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const size_t frames = comp::ldpc::encode_frames(g, enc, in, out);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "k: " << enc.k() << ", gap: " << enc.gap.size() << std::endl;
+        std::cout << "Frames: " << frames << std::endl;
+        std::cout << "Mbit/s: " << frames * enc.k() / elapsed.count() / 1e6 << std::endl;
+
+        if (stats)
+        {
+            stats->add_time("encoding", elapsed.count());
+            stats->set("k", enc.k());
+            stats->set("frames", frames);
+            stats->print(std::cout);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (!frames_filename.empty())
+    {
+        const std::string out_filename = frames_filename + decoded_ext;
+
+        std::ifstream in(frames_filename, std::ios::binary);
+        std::ofstream out(out_filename, std::ios::binary);
+        std::ofstream report(out_filename + report_ext);
+
+        if (!in)
+        {
+            std::cerr << "Error opening file " << frames_filename << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!out || !report)
+        {
+            std::cerr << "Error opening file " << out_filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        report << "frame,iterations,converged" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        comp::frame_stats fs = comp::ldpc::decode_frames(g, in, out, &report, threads, max_iterations, layers);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "Frames: " << fs.frames << ", converged: " << fs.converged << std::endl;
+        std::cout << "Frames/s: " << fs.frames / elapsed.count() << std::endl;
+
+        size_t total = 0;
+        for (size_t it = 0; it < fs.iterations.size(); it++)
+        {
+            if (fs.iterations[it])
+            {
+                std::cout << "Iterations " << it << ": " << fs.iterations[it] << std::endl;
+            }
+            total += it * fs.iterations[it];
+        }
+
+        if (stats)
+        {
+            stats->add_time("decoding", elapsed.count());
+            stats->set("frames", fs.frames);
+            stats->set("converged_frames", fs.converged);
+            stats->set("average_iterations", fs.frames ? static_cast<double>(total) / fs.frames : 0);
+            stats->print(std::cout);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (sim_points && bec)
+    {
+        build_encoder();
+
+        /* Linearly spaced erasure probabilities. Symbol (block) error and frame error rates after decoding,
+         * the share of frames that needed elimination, and decoding throughput per core: */
+        std::cout << "p,frames,frame_errors,ser,fer,eliminated,mbytes_per_core" << std::endl;
+
+        for (size_t i = 0; i < sim_points; i++)
+        {
+            const double t = (sim_points > 1) ? static_cast<double>(i) / (sim_points - 1) : 0.0;
+            const double p = sim_p_min + (sim_p_max - sim_p_min) * t;
+
+            comp::sim_point r = comp::ldpc::simulate_bec(g, enc, p, erasure_symbol_size, target_errors, max_frames, seed + i * 0x10000, threads);
+            const double symbols = static_cast<double>(r.frames) * g.num_bits();
+
+            std::cout << r.p << "," << r.frames << "," << r.frame_errors << ","
+                      << r.bit_errors / symbols << "," << static_cast<double>(r.frame_errors) / r.frames << ","
+                      << static_cast<double>(r.eliminations) / r.frames << "," << symbols * erasure_symbol_size / r.seconds / 1e6 << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (sim_points && awgn && target_fer > 0)
+    {
+        /* Decoders compared at equal FER: for each one, bisect Eb/N0 (FER falls as it grows) and report the last point at or below
+         * the target. Gallager B decodes the signs of the samples, so it needs a much stronger signal. Throughput is per core,
+         * decoding only; a decoder that misses the target even at the maximum is reported there: */
+        std::cout << "target_fer,decoder,ebn0_db,frames,frame_errors,ber,fer,avg_iterations,mbps_per_core" << std::endl;
+
+        const char *names[] = {"min-sum", "gallager-b", "qc-min-sum"};
+
+        for (int decoder = 0; decoder < (qc.z ? 3 : 2); decoder++)
+        {
+            auto measure = [&](double ebn0, size_t step)
+            {
+                if (decoder == 2)
+                {
+                    return comp::ldpc::simulate_awgn(qc, ebn0, target_errors, max_frames, seed + step * 0x10000, threads, max_iterations);
+                }
+
+                const unsigned which = (decoder == 0) ? comp::ldpc::awgn_min_sum : comp::ldpc::awgn_gallager_b;
+                auto [ms, gb] = comp::ldpc::simulate_awgn(g, ebn0, target_errors, max_frames, seed + step * 0x10000, threads, max_iterations, which);
+                return (decoder == 0) ? ms : gb;
+            };
+
+            auto fer = [](const comp::sim_point &r)
+            {
+                return static_cast<double>(r.frame_errors) / r.frames;
+            };
+
+            double lo = sim_p_min, hi = sim_p_max;
+            comp::sim_point best = measure(hi, 0);
+
+            for (size_t step = 1; step < sim_points && fer(best) <= target_fer; step++)
+            {
+                const double mid = (lo + hi) / 2;
+                const comp::sim_point r = measure(mid, step);
+
+                if (fer(r) <= target_fer)
+                {
+                    hi = mid;
+                    best = r;
+                }
+                else
+                {
+                    lo = mid;
+                }
+            }
+
+            const double bits = static_cast<double>(best.frames) * g.num_bits();
+
+            std::cout << target_fer << "," << names[decoder] << "," << best.p << "," << best.frames << "," << best.frame_errors << ","
+                      << best.bit_errors / bits << "," << fer(best) << "," << static_cast<double>(best.iterations) / best.frames << ","
+                      << bits / best.seconds / 1e6 << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (sim_points && awgn)
+    {
+        /* Linearly spaced Eb/N0 (dB), both decoders on the same samples (and the circulant decoder, on its own, for a QC code).
+         * Gallager B decodes their signs, see simulate_awgn(). Throughput is per core, decoding only; the decoders differ in FER
+         * at every point, -t compares them at equal FER: */
+        std::cout << "ebn0_db,decoder,frames,frame_errors,ber,fer,avg_iterations,mbps_per_core" << std::endl;
+
+        for (size_t i = 0; i < sim_points; i++)
+        {
+            const double t = (sim_points > 1) ? static_cast<double>(i) / (sim_points - 1) : 0.0;
+            const double ebn0 = sim_p_min + (sim_p_max - sim_p_min) * t;
+
+            auto [ms, gb] = comp::ldpc::simulate_awgn(g, ebn0, target_errors, max_frames, seed + i * 0x10000, threads, max_iterations);
+            comp::sim_point qms;
+
+            if (qc.z)
+            {
+                qms = comp::ldpc::simulate_awgn(qc, ebn0, target_errors, max_frames, seed + i * 0x10000, threads, max_iterations);
+            }
+
+            for (auto [name, r] : {std::make_pair("min-sum", &ms), std::make_pair("gallager-b", &gb), std::make_pair("qc-min-sum", &qms)})
+            {
+                if (r->frames == 0)
+                {
+                    continue;
+                }
+
+                const double bits = static_cast<double>(r->frames) * g.num_bits();
+
+                std::cout << ebn0 << "," << name << "," << r->frames << "," << r->frame_errors << ","
+                          << r->bit_errors / bits << "," << static_cast<double>(r->frame_errors) / r->frames << ","
+                          << static_cast<double>(r->iterations) / r->frames << "," << bits / r->seconds / 1e6 << std::endl;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (sim_points)
+    {
+        /* Log-spaced crossover probabilities, from the worst channel down, as CSV: */
+        std::cout << "p,frames,frame_errors,ber,fer,avg_iterations,mbps" << std::endl;
+
+        for (size_t i = 0; i < sim_points; i++)
+        {
+            const double t = (sim_points > 1) ? static_cast<double>(i) / (sim_points - 1) : 0.0;
+            const double p = sim_p_max * std::pow(sim_p_min / sim_p_max, t);
+
+            comp::sim_point r = comp::ldpc::simulate(g, p, target_errors, max_frames, seed + i * 0x10000, threads, max_iterations, layers);
+            const double bits = static_cast<double>(r.frames) * g.num_bits();
+
+            std::cout << r.p << "," << r.frames << "," << r.frame_errors << ","
+                      << r.bit_errors / bits << "," << static_cast<double>(r.frame_errors) / r.frames << ","
+                      << static_cast<double>(r.iterations) / r.frames << "," << bits / r.seconds / 1e6 << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (g.num_bits() <= print_limit)
+    {
+        /* Matrix H: */
+        g.print();
+    }
+
+    if (demo)
+    {
+        std::cout << "===================" << std::endl;
+
+        std::vector<int> received = {1, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 1, 1, 0};
+
+        std::vector<int> decoded = comp::ldpc::gallager_b_decode(g, received, 10, nullptr, layers);
+
+        for (int bit : decoded)
+        {
+            std::cout << bit << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,545 @@
+/* Compression + channel coding: LZW-compressed blocks, protected by an LDPC code. */
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <charconv>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "lzw.hpp"
+#include "ldpc.hpp"
+#include "common.hpp"
+#include "bounded_queue.hpp"
+#include "file_io.hpp"
+#include "stats.hpp"
+
+/* Code constructions, as stored in the header: */
+enum construction : uint8_t
+{
+    gallager_code = 0,
+    peg_code = 1
+};
+
+/* Default code, PEG (rate 1/2): `n` bits of degree `w_c`, `m` checks. Unlike a Gallager code of the same degrees, it has no 4-cycles,
+ * which keep Gallager B from correcting even a few flipped bits: */
+const construction type = peg_code;
+const uint32_t n = 4096;
+const uint32_t m = 2048;
+
+const uint32_t w_c = 4;
+
+const uint64_t seed = 492018;
+
+/* Input is compressed in independent blocks of this size. A frame that fails to decode loses its whole block: */
+const size_t block_size = 64 << 10;
+
+/* Largest parameters accepted, on the command line or in the header of a file to decode: */
+const uint32_t max_n = 1 << 16;
+const uint32_t max_weight = 32;
+const size_t max_block_size = 64 << 20;
+
+/* Blocks waiting between two stages; bounds memory to a few blocks per stage: */
+const size_t queue_depth = 4;
+
+const std::string ext = ".fec";
+
+/*
+ * Format:
+ * 1. { magic | version | construction | n | w_r (Gallager) or m (PEG) | w_c | seed | block size }, the code is rebuilt from its parameters
+ * 2. { index | raw size | compressed size | frame count | frames }, once per block
+ *
+ * Numbers are little endian, 32-bit except the 8-bit version and construction and the 64-bit seed.
+ * Frames are LDPC codewords of n bits (decode_frames() layout)
+ * carrying the LZW stream of the block, k bits per frame. Headers are not protected, only the payload.
+ */
+const char magic[] = {'F', 'E', 'C'};
+const uint8_t version = 2;
+
+/* A block on its way through the pipeline; `data` holds whatever the last stage produced: */
+struct block
+{
+    uint32_t index = 0;
+    uint32_t raw_size = 0;
+    uint32_t compressed_size = 0;
+    uint32_t frames = 0;
+    std::vector<uint8_t> data;
+
+    /* Decoding only: */
+    size_t converged = 0;
+    size_t iterations = 0;
+    bool corrupt = false;
+};
+
+typedef comp::bounded_queue<block> block_queue;
+
+void put(comp::output_file &out, uint64_t value, int bytes)
+{
+    uint8_t buf[8];
+
+    for (int i = 0; i < bytes; i++)
+    {
+        buf[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+    }
+    out.write(std::span<const uint8_t>(buf, bytes));
+}
+
+bool get(comp::input_file &in, uint64_t &value, int bytes)
+{
+    const std::span<const uint8_t> buf = in.next(bytes);
+
+    if (buf.size() != static_cast<size_t>(bytes))
+    {
+        return false;
+    }
+
+    value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        value |= static_cast<uint64_t>(buf[i]) << (8 * i);
+    }
+    return true;
+}
+
+/* Runs `fn` on every block from `in`, on its own thread, passing results to `out`. `seconds` receives the time spent in `fn`
+ * (not waiting on either queue), which is what limits the pipeline's throughput. */
+template <typename F>
+std::thread stage(block_queue &in, block_queue &out, double &seconds, F fn)
+{
+    return std::thread([&in, &out, &seconds, fn]()
+                       {
+        block b;
+        while (in.pop(b))
+        {
+            auto start = std::chrono::steady_clock::now();
+            fn(b);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (!out.push(std::move(b)))
+            {
+                break;
+            }
+        }
+        out.close(); });
+}
+
+/* False unless all of `arg` is a number: */
+template <typename T>
+bool parse_number(const char *arg, T &value)
+{
+    const char *end = arg + std::strlen(arg);
+    const auto [last, error] = std::from_chars(arg, end, value);
+
+    return error == std::errc() && last == end && last != arg;
+}
+
+/* Parameters the construction can build a code of rate above 0 from, within the limits above. `second` is w_r (Gallager) or m (PEG): */
+bool valid_code(uint64_t code_type, uint64_t code_n, uint64_t second, uint64_t code_w_c)
+{
+    if (code_n == 0 || code_n > max_n || code_w_c == 0 || code_w_c > max_weight)
+    {
+        return false;
+    }
+
+    switch (code_type)
+    {
+    case gallager_code:
+        return code_w_c < second && second <= max_weight && code_n % second == 0;
+    case peg_code:
+        return code_w_c <= second && second < code_n;
+    default:
+        return false;
+    }
+}
+
+/* valid_code() rules out what gallager() cannot build; PEG may still run out of checks for a dense code: */
+bool build(comp::tanner_graph &g, construction code_type, uint32_t code_n, uint32_t second, uint32_t code_w_c, uint64_t code_seed)
+{
+    if (code_type == peg_code)
+    {
+        return comp::ldpc::peg(g, code_n, second, code_w_c, code_seed);
+    }
+
+    return comp::ldpc::gallager(g, code_n, second, code_w_c, code_seed);
+}
+
+void usage()
+{
+    std::cout << "Usage: {-e|-d} <filename> [-g <n> <w_r> <w_c> [seed] | -p <n> <m> <w_c> [seed]] [-b <block KiB>] [-i <max iterations>] [-x <bit flip probability>] [--stats[=json]]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string mode(argv[1]);
+    const std::string filename(argv[2]);
+
+    construction code_type = type;
+
+    /* w_r (Gallager) or m (PEG): */
+    uint32_t code_n = n, second = m, code_w_c = w_c;
+    uint64_t code_seed = seed;
+    size_t code_block_size = block_size;
+    int max_iterations = 20;
+    double flip = 0;
+    comp::stats::format format = comp::stats::off;
+    bool valid = true;
+
+    for (int i = 3; i < argc && valid; i++)
+    {
+        const std::string arg(argv[i]);
+        const int left = argc - i - 1;
+
+        if ((arg == "-g" || arg == "-p") && left >= 3)
+        {
+            code_type = (arg == "-g") ? gallager_code : peg_code;
+            valid = parse_number(argv[i + 1], code_n) && parse_number(argv[i + 2], second) && parse_number(argv[i + 3], code_w_c) &&
+                    valid_code(code_type, code_n, second, code_w_c);
+            i += 3;
+
+            if (valid && left >= 4 && argv[i + 1][0] != '-')
+            {
+                valid = parse_number(argv[++i], code_seed);
+            }
+        }
+        else if (arg == "-b" && left >= 1)
+        {
+            size_t kib;
+
+            valid = parse_number(argv[++i], kib) && kib > 0 && kib <= (max_block_size >> 10);
+            code_block_size = kib << 10;
+        }
+        else if (arg == "-i" && left >= 1)
+        {
+            valid = parse_number(argv[++i], max_iterations) && max_iterations >= 0 && max_iterations <= 255;
+        }
+        else if (arg == "-x" && left >= 1)
+        {
+            valid = parse_number(argv[++i], flip) && flip >= 0 && flip <= 1;
+        }
+        else if (!comp::stats::parse(arg, format))
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    const bool encoding = (mode == "-e");
+
+    if (!encoding && mode != "-d")
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string out_filename = encoding ? filename + ext : comp::common::trim_string_ext(filename);
+
+    comp::input_file in;
+    comp::output_file out;
+
+    if (!in.open(filename))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!encoding)
+    {
+        const std::span<const uint8_t> file_magic = in.next(sizeof(magic));
+        uint64_t file_version, value[6];
+
+        if (file_magic.size() != sizeof(magic) || !std::equal(file_magic.begin(), file_magic.end(), magic) ||
+            !get(in, file_version, 1) || file_version != version ||
+            !get(in, value[0], 1) || !get(in, value[1], 4) || !get(in, value[2], 4) || !get(in, value[3], 4) || !get(in, value[4], 8) ||
+            !get(in, value[5], 4))
+        {
+            std::cerr << "Corrupt file " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        /* The code is built from these, so they must not reach the constructions unchecked: */
+        if (!valid_code(value[0], value[1], value[2], value[3]) || value[5] == 0 || value[5] > max_block_size)
+        {
+            std::cerr << "Unsupported code or block size in " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        code_type = static_cast<construction>(value[0]);
+        code_n = value[1];
+        second = value[2];
+        code_w_c = value[3];
+        code_seed = value[4];
+        code_block_size = value[5];
+    }
+
+    comp::tanner_graph g;
+    comp::systematic_encoder enc;
+
+    if (!build(g, code_type, code_n, second, code_w_c, code_seed))
+    {
+        std::cerr << "No PEG code: too dense, a variable has no free check left" << std::endl;
+        return EXIT_FAILURE;
+    }
+    enc.build(g);
+
+    /* Decoding, only once the header has been checked and the code built: */
+    if (!out.open(out_filename, &in))
+    {
+        return EXIT_FAILURE;
+    }
+
+    const size_t k = enc.k();
+    const size_t frame_bytes = (g.num_bits() + 7) / 8;
+
+    /* Layered Gallager B, the checks in `w_c` groups (for a Gallager code, its row blocks), which needs fewer iterations: */
+    const uint32_t layers = code_w_c;
+
+    /* read -> [compress -> encode | decode -> decompress] -> write, one thread each: */
+    block_queue read_queue(queue_depth), middle_queue(queue_depth), write_queue(queue_depth);
+    double seconds[4] = {};
+    size_t blocks = 0, frames = 0, converged = 0, iterations = 0, corrupt = 0;
+    bool truncated = false;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+
+    if (encoding)
+    {
+        out.write(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(magic), sizeof(magic)));
+        put(out, version, 1);
+        put(out, code_type, 1);
+        put(out, code_n, 4);
+        put(out, second, 4);
+        put(out, code_w_c, 4);
+        put(out, code_seed, 8);
+        put(out, code_block_size, 4);
+
+        threads.push_back(std::thread([&]()
+                                      {
+            for (uint32_t index = 0;; index++)
+            {
+                auto t = std::chrono::steady_clock::now();
+
+                const std::span<const uint8_t> raw = in.next(code_block_size);
+
+                block b;
+                b.index = index;
+                b.raw_size = raw.size();
+                b.data.assign(raw.begin(), raw.end());
+
+                seconds[0] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+
+                if (b.raw_size == 0 || !read_queue.push(std::move(b)))
+                {
+                    break;
+                }
+            }
+            read_queue.close(); }));
+
+        threads.push_back(stage(read_queue, middle_queue, seconds[1], [](block &b)
+                                {
+            std::vector<uint8_t> compressed;
+
+            comp::lzw::encode(b.data, compressed);
+
+            b.data.swap(compressed);
+            b.compressed_size = b.data.size(); }));
+
+        threads.push_back(stage(middle_queue, write_queue, seconds[2], [&g, &enc](block &b)
+                                {
+            std::vector<uint8_t> encoded;
+
+            b.frames = comp::ldpc::encode_frames(g, enc, b.data, encoded);
+            b.data.swap(encoded); }));
+    }
+    else
+    {
+        threads.push_back(std::thread([&]()
+                                      {
+            comp::Random rng(seed);
+
+            for (;;)
+            {
+                auto t = std::chrono::steady_clock::now();
+
+                block b;
+                uint64_t value[4];
+
+                if (!get(in, value[0], 4) || !get(in, value[1], 4) || !get(in, value[2], 4) || !get(in, value[3], 4))
+                {
+                    break;
+                }
+
+                b.index = value[0];
+                b.raw_size = value[1];
+                b.compressed_size = value[2];
+                b.frames = value[3];
+
+                /* A damaged header would otherwise ask for any amount of memory: */
+                if (b.raw_size > code_block_size || b.frames != (static_cast<size_t>(b.compressed_size) * 8 + k - 1) / k ||
+                    b.compressed_size > 4 * code_block_size + 64)
+                {
+                    truncated = true;
+                    break;
+                }
+
+                const std::span<const uint8_t> payload = in.next(b.frames * frame_bytes);
+
+                if (payload.size() != b.frames * frame_bytes)
+                {
+                    truncated = true;
+                    break;
+                }
+                b.data.assign(payload.begin(), payload.end());
+
+                /* Channel test, damages the payload before it is decoded: */
+                if (flip > 0)
+                {
+                    for (size_t i = 0; i < b.frames * g.num_bits(); i++)
+                    {
+                        if (rng.uniform() <= flip)
+                        {
+                            const size_t frame = i / g.num_bits(), bit = i % g.num_bits();
+                            b.data[frame * frame_bytes + bit / 8] ^= 0x80 >> (bit % 8);
+                        }
+                    }
+                }
+
+                seconds[0] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+
+                if (!read_queue.push(std::move(b)))
+                {
+                    break;
+                }
+            }
+            read_queue.close(); }));
+
+        threads.push_back(stage(read_queue, middle_queue, seconds[1], [&g, &enc, k, frame_bytes, max_iterations, layers](block &b)
+                                {
+            std::vector<uint8_t> codewords;
+
+            const comp::frame_stats fs = comp::ldpc::decode_frames(g, b.data, codewords, max_iterations, layers);
+
+            b.converged = fs.converged;
+            for (size_t it = 0; it < fs.iterations.size(); it++)
+            {
+                b.iterations += it * fs.iterations[it];
+            }
+
+            /* Concatenate the k-bit messages, then drop the padding of the last one: */
+            std::vector<uint8_t> message((k + 7) / 8);
+            std::vector<uint8_t> compressed((b.frames * k + 7) / 8, 0);
+
+            for (size_t f = 0; f < b.frames; f++)
+            {
+                enc.extract(&codewords[f * frame_bytes], message.data());
+
+                for (size_t j = 0; j < k; j++)
+                {
+                    const size_t bit = f * k + j;
+                    compressed[bit / 8] |= ((message[j / 8] >> (7 - j % 8)) & 0x1) << (7 - bit % 8);
+                }
+            }
+
+            compressed.resize(std::min<size_t>(b.compressed_size, compressed.size()));
+            b.data = std::move(compressed); }));
+
+        threads.push_back(stage(middle_queue, write_queue, seconds[2], [](block &b)
+                                {
+            std::vector<uint8_t> raw;
+
+            b.corrupt = comp::lzw::decode(b.data, raw) != comp::lzw::ok;
+            b.data.swap(raw);
+
+            /* Whatever happened, the block keeps its size, so later blocks stay at their offsets: */
+            b.corrupt = b.corrupt || b.data.size() != b.raw_size;
+            b.data.resize(b.raw_size, 0); }));
+    }
+
+    block b;
+    while (write_queue.pop(b))
+    {
+        auto t = std::chrono::steady_clock::now();
+
+        if (encoding)
+        {
+            put(out, b.index, 4);
+            put(out, b.raw_size, 4);
+            put(out, b.compressed_size, 4);
+            put(out, b.frames, 4);
+        }
+        else if (b.corrupt)
+        {
+            std::cerr << "Block " << b.index << " could not be recovered" << std::endl;
+            corrupt++;
+        }
+
+        out.write(b.data);
+
+        blocks++;
+        frames += b.frames;
+        converged += b.converged;
+        iterations += b.iterations;
+
+        seconds[3] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    const bool written = out.close();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (!written || in.failed())
+    {
+        return EXIT_FAILURE;
+    }
+
+    const std::unique_ptr<comp::stats> stats = comp::stats::make(format);
+
+    if (stats)
+    {
+        const char *names[] = {"read", encoding ? "compress" : "LDPC decode", encoding ? "LDPC encode" : "decompress", "write"};
+
+        for (int i = 0; i < 4; i++)
+        {
+            stats->add_time(names[i], seconds[i]);
+        }
+        stats->add_time("wall", elapsed.count());
+
+        stats->set("n", g.num_bits());
+        stats->set("k", k);
+        stats->set("block_size", code_block_size);
+        stats->set("blocks", blocks);
+        stats->set("frames", frames);
+        if (!encoding)
+        {
+            stats->set("converged_frames", converged);
+            stats->set("average_iterations", frames ? static_cast<double>(iterations) / frames : 0);
+            stats->set("unrecovered_blocks", corrupt);
+        }
+        stats->print(std::cout);
+    }
+
+    if (truncated)
+    {
+        std::cerr << "Truncated or corrupt file " << filename << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return corrupt ? EXIT_FAILURE : EXIT_SUCCESS;
+}
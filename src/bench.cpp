@@ -0,0 +1,522 @@
+/* Benchmark: every codec, both directions, on synthetic corpora of known character.
+ * With -k: what block checksums cost, on the same corpora, codecs and block format with and without them. */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "codec.hpp"
+#include "container.hpp"
+#include "seekable.hpp"
+#include "checksum.hpp"
+#include "stats.hpp"
+
+/* Corpora are generated from this, so every run sees the same bytes: */
+const uint64_t seed = 492018;
+
+const size_t corpus_size = 1 << 20;
+const size_t repeats = 5;
+
+/* Telemetry: one line per sample, this many sensors: */
+const size_t sensors = 16;
+
+/* Mixed binary is made of segments of this size, of a kind picked at random: */
+const size_t segment_size = 4096;
+
+const char *const words[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on", "not", "he",
+    "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had", "they", "you", "were", "their", "one",
+    "all", "we", "can", "her", "has", "there", "been", "if", "more", "when", "will", "would", "who", "so", "no", "data",
+    "system", "block", "code", "time", "number", "value", "signal", "channel", "error", "decoder", "compression", "between"};
+
+const size_t word_count = sizeof(words) / sizeof(words[0]);
+
+typedef std::vector<uint8_t> (*generator)(size_t size, std::mt19937_64 &rng);
+
+std::vector<uint8_t> random_corpus(size_t size, std::mt19937_64 &rng)
+{
+    std::vector<uint8_t> data(size);
+
+    for (auto &byte : data)
+    {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+/* Words drawn with Zipf-like frequencies (the list is in rough frequency order), sentences and paragraphs: */
+std::vector<uint8_t> text_corpus(size_t size, std::mt19937_64 &rng)
+{
+    std::vector<double> weights(word_count);
+    for (size_t i = 0; i < word_count; i++)
+    {
+        weights[i] = 1.0 / (i + 1);
+    }
+
+    std::discrete_distribution<size_t> word(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> sentence(4, 18), paragraph(3, 8);
+    std::string text;
+
+    while (text.size() < size)
+    {
+        for (int s = paragraph(rng); s > 0; s--)
+        {
+            const int length = sentence(rng);
+
+            for (int i = 0; i < length; i++)
+            {
+                std::string w = words[word(rng)];
+
+                if (i == 0)
+                {
+                    w[0] = std::toupper(w[0]);
+                }
+                text += w;
+                text += (i + 1 == length) ? ". " : (rng() % 9 == 0) ? ", " : " ";
+            }
+        }
+        text += "\n\n";
+    }
+
+    return std::vector<uint8_t>(text.begin(), text.begin() + size);
+}
+
+/* A handful of short records repeated over and over, one byte in a thousand changed: */
+std::vector<uint8_t> repetitive_corpus(size_t size, std::mt19937_64 &rng)
+{
+    std::vector<std::vector<uint8_t>> records(4);
+    std::vector<uint8_t> data;
+
+    for (auto &r : records)
+    {
+        r = random_corpus(16 + rng() % 48, rng);
+    }
+
+    while (data.size() < size)
+    {
+        const auto &r = records[rng() % records.size()];
+        data.insert(data.end(), r.begin(), r.end());
+    }
+    data.resize(size);
+
+    for (auto &byte : data)
+    {
+        if (rng() % 1000 == 0)
+        {
+            byte = static_cast<uint8_t>(rng());
+        }
+    }
+    return data;
+}
+
+/* CSV lines of slowly drifting readings: "<timestamp>,<sensor>,<value>": */
+std::vector<uint8_t> telemetry_corpus(size_t size, std::mt19937_64 &rng)
+{
+    std::normal_distribution<double> step(0.0, 0.05);
+    std::vector<double> value(sensors, 20.0);
+    std::string text;
+    uint64_t timestamp = 1700000000000;
+
+    while (text.size() < size)
+    {
+        for (size_t s = 0; s < sensors; s++)
+        {
+            value[s] += step(rng);
+
+            std::ostringstream line;
+            line << timestamp << ",sensor" << s << "," << std::fixed << std::setprecision(3) << value[s] << "\n";
+            text += line.str();
+        }
+        timestamp += 250 + rng() % 10;
+    }
+
+    return std::vector<uint8_t>(text.begin(), text.begin() + size);
+}
+
+/* Segments of random bytes, zero runs, small little-endian integers and text, as in a typical binary file: */
+std::vector<uint8_t> binary_corpus(size_t size, std::mt19937_64 &rng)
+{
+    std::vector<uint8_t> data;
+
+    while (data.size() < size)
+    {
+        std::vector<uint8_t> segment;
+
+        switch (rng() % 4)
+        {
+        case 0:
+            segment = random_corpus(segment_size, rng);
+            break;
+        case 1:
+            segment.assign(segment_size, 0);
+            break;
+        case 2:
+        {
+            uint32_t v = rng() % 1000;
+            for (size_t i = 0; i < segment_size; i += 4)
+            {
+                v += rng() % 16;
+                for (int b = 0; b < 4; b++)
+                {
+                    segment.push_back(static_cast<uint8_t>(v >> (8 * b)));
+                }
+            }
+            break;
+        }
+        default:
+            segment = text_corpus(segment_size, rng);
+        }
+
+        data.insert(data.end(), segment.begin(), segment.end());
+    }
+    data.resize(size);
+    return data;
+}
+
+/* Random bytes, then text, then zeros, with boundaries off any block size: what adapts to the data, and what
+ * keeps coding the text with a dictionary full of random strings: */
+std::vector<uint8_t> shifting_corpus(size_t size, std::mt19937_64 &rng)
+{
+    std::vector<uint8_t> data = random_corpus(size / 10, rng);
+    const std::vector<uint8_t> text = text_corpus(size / 2, rng);
+
+    data.insert(data.end(), text.begin(), text.end());
+    data.resize(size, 0);
+    return data;
+}
+
+struct corpus
+{
+    const char *name;
+    generator generate;
+};
+
+const corpus corpora[] = {
+    {"random", random_corpus},
+    {"text", text_corpus},
+    {"repetitive", repetitive_corpus},
+    {"telemetry", telemetry_corpus},
+    {"binary", binary_corpus},
+    {"shifting", shifting_corpus}};
+
+/* What a child process sends back, medians over the repeats. With -k, the first are without checksums: */
+struct result
+{
+    uint64_t compressed = 0;
+    double encode_seconds = 0;
+    double decode_seconds = 0;
+    long peak_rss = 0;
+    bool ok = false;
+
+    uint64_t checked_compressed = 0;
+    double checked_encode_seconds = 0;
+    double checked_decode_seconds = 0;
+};
+
+double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    const size_t mid = v.size() / 2;
+
+    return (v.size() % 2) ? v[mid] : (v[mid - 1] + v[mid]) / 2;
+}
+
+/* Seekable format, the default block size; full decoding goes through the stream decoder, which checks every block: */
+double time_blocks(comp::codec_id id, const std::vector<uint8_t> &data, bool checksums, std::vector<uint8_t> &compressed,
+                   std::vector<uint8_t> &decompressed, double &decode_seconds, bool &ok)
+{
+    compressed.clear();
+    decompressed.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    comp::seekable::encoder(id, comp::seekable::default_block_size, checksums)->run(data, compressed);
+    auto middle = std::chrono::steady_clock::now();
+    ok = ok && comp::container::decompress(compressed, decompressed) && decompressed == data;
+    auto end = std::chrono::steady_clock::now();
+
+    decode_seconds = std::chrono::duration<double>(end - middle).count();
+    return std::chrono::duration<double>(middle - start).count();
+}
+
+/* Both ways in turn, every repeat, so that drifting clocks and caches weigh on both alike: */
+result measure_checksums(comp::codec_id id, const std::vector<uint8_t> &data, size_t repeats)
+{
+    std::vector<uint8_t> compressed, decompressed;
+    std::vector<double> encode, decode, checked_encode, checked_decode;
+    double seconds;
+    result r;
+
+    r.ok = true;
+    for (size_t i = 0; i < repeats && r.ok; i++)
+    {
+        encode.push_back(time_blocks(id, data, false, compressed, decompressed, seconds, r.ok));
+        decode.push_back(seconds);
+        r.compressed = compressed.size();
+
+        checked_encode.push_back(time_blocks(id, data, true, compressed, decompressed, seconds, r.ok));
+        checked_decode.push_back(seconds);
+        r.checked_compressed = compressed.size();
+    }
+
+    r.encode_seconds = median(encode);
+    r.decode_seconds = median(decode);
+    r.checked_encode_seconds = median(checked_encode);
+    r.checked_decode_seconds = median(checked_decode);
+    return r;
+}
+
+result measure(comp::codec_id id, const std::vector<uint8_t> &data, size_t repeats)
+{
+    std::vector<uint8_t> compressed, decompressed;
+    std::vector<double> encode, decode;
+    result r;
+
+    r.ok = true;
+    for (size_t i = 0; i < repeats && r.ok; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        comp::codec::compress(id, data, compressed);
+        auto middle = std::chrono::steady_clock::now();
+        r.ok = comp::codec::decompress(id, compressed, decompressed);
+        auto end = std::chrono::steady_clock::now();
+
+        r.ok = r.ok && decompressed == data;
+
+        encode.push_back(std::chrono::duration<double>(middle - start).count());
+        decode.push_back(std::chrono::duration<double>(end - middle).count());
+    }
+
+    r.compressed = compressed.size();
+    r.encode_seconds = median(encode);
+    r.decode_seconds = median(decode);
+    return r;
+}
+
+/* Every measurement runs in a child process of its own, so its peak RSS is not that of the runs before it: */
+bool measure_apart(comp::codec_id id, const std::vector<uint8_t> &data, size_t repeats, bool checksums, result &r)
+{
+    int fds[2];
+
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        result child = checksums ? measure_checksums(id, data, repeats) : measure(id, data, repeats);
+        const bool sent = write(fds[1], &child, sizeof(child)) == sizeof(child);
+        _exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    const bool received = read(fds[0], &r, sizeof(r)) == sizeof(r);
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || !received)
+    {
+        return false;
+    }
+
+    /* KiB on Linux: */
+    r.peak_rss = usage.ru_maxrss;
+    return true;
+}
+
+void usage()
+{
+    std::cout << "Usage: [-s <corpus KiB>] [-r <repeats>] [-c <codec>] [-t <corpus>] [-j <JSON file>] [-k] [--stats[=json]]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size = corpus_size;
+    size_t runs = repeats;
+    std::string only_codec, only_corpus, json_filename;
+    comp::stats::format format = comp::stats::off;
+    bool checksums = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        const int left = argc - i - 1;
+
+        if (arg == "-s" && left >= 1)
+        {
+            size = std::stoul(argv[++i]) << 10;
+        }
+        else if (arg == "-r" && left >= 1)
+        {
+            runs = std::max(std::stoul(argv[++i]), 1UL);
+        }
+        else if (arg == "-c" && left >= 1)
+        {
+            only_codec = argv[++i];
+        }
+        else if (arg == "-t" && left >= 1)
+        {
+            only_corpus = argv[++i];
+        }
+        else if (arg == "-j" && left >= 1)
+        {
+            json_filename = argv[++i];
+        }
+        else if (arg == "-k")
+        {
+            checksums = true;
+        }
+        else if (comp::stats::parse(arg, format))
+        {
+            continue;
+        }
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::unique_ptr<comp::stats> stats = comp::stats::make(format);
+    std::ostringstream json;
+    bool failed = false, first = true;
+
+    std::cout << "Corpus: " << size << " bytes, median of " << runs << " runs" << std::endl;
+
+    if (checksums)
+    {
+        std::cout << "Blocks of " << comp::seekable::default_block_size << " bytes, CRC32C " << (comp::checksum::hardware() ? "(SSE4.2)" : "(tables)")
+                  << "; overhead is the time added by checksums" << std::endl;
+        std::cout << std::left << std::setw(12) << "corpus" << std::setw(6) << "codec" << std::right << std::setw(12) << "enc MB/s"
+                  << std::setw(12) << "+crc MB/s" << std::setw(10) << "enc %" << std::setw(12) << "dec MB/s" << std::setw(12) << "+crc MB/s"
+                  << std::setw(10) << "dec %" << std::endl;
+    }
+    else
+    {
+        std::cout << std::left << std::setw(12) << "corpus" << std::setw(6) << "codec" << std::right << std::setw(12) << "compressed"
+                  << std::setw(8) << "ratio" << std::setw(12) << "enc MB/s" << std::setw(12) << "dec MB/s" << std::setw(12) << "RSS KiB" << std::endl;
+    }
+
+    json << "[";
+    for (const corpus &c : corpora)
+    {
+        if (!only_corpus.empty() && only_corpus != c.name)
+        {
+            continue;
+        }
+
+        std::mt19937_64 rng(seed);
+
+        comp::stats::timer generation(stats.get(), "corpus generation");
+        const std::vector<uint8_t> data = c.generate(size, rng);
+        generation.stop();
+
+        for (size_t i = 0; i < comp::codec::count; i++)
+        {
+            const comp::codec_id id = static_cast<comp::codec_id>(i);
+            const std::string name = comp::codec::name(id);
+            result r;
+
+            if (!only_codec.empty() && only_codec != name)
+            {
+                continue;
+            }
+
+            comp::stats::timer measurement(stats.get(), "measurement");
+            const bool measured = measure_apart(id, data, runs, checksums, r);
+            measurement.stop();
+
+            if (!measured || !r.ok)
+            {
+                std::cerr << "Round trip failed: " << name << " on " << c.name << std::endl;
+                failed = true;
+                continue;
+            }
+
+            const double ratio = r.compressed ? static_cast<double>(data.size()) / r.compressed : 0;
+            const double encode_speed = data.size() / 1e6 / r.encode_seconds;
+            const double decode_speed = data.size() / 1e6 / r.decode_seconds;
+
+            if (checksums)
+            {
+                const double checked_encode_speed = data.size() / 1e6 / r.checked_encode_seconds;
+                const double checked_decode_speed = data.size() / 1e6 / r.checked_decode_seconds;
+                const double encode_overhead = 100 * (r.checked_encode_seconds / r.encode_seconds - 1);
+                const double decode_overhead = 100 * (r.checked_decode_seconds / r.decode_seconds - 1);
+
+                std::cout << std::left << std::setw(12) << c.name << std::setw(6) << name << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(12) << encode_speed << std::setw(12) << checked_encode_speed << std::setw(10) << encode_overhead
+                          << std::setw(12) << decode_speed << std::setw(12) << checked_decode_speed << std::setw(10) << decode_overhead << std::endl;
+
+                json << (first ? "\n" : ",\n") << "  {\"corpus\": \"" << c.name << "\", \"codec\": \"" << name << "\", \"input_bytes\": " << data.size()
+                     << ", \"compressed_bytes\": " << r.compressed << ", \"checked_compressed_bytes\": " << r.checked_compressed
+                     << ", \"encode_mb_s\": " << encode_speed << ", \"checked_encode_mb_s\": " << checked_encode_speed
+                     << ", \"encode_overhead_percent\": " << encode_overhead << ", \"decode_mb_s\": " << decode_speed
+                     << ", \"checked_decode_mb_s\": " << checked_decode_speed << ", \"decode_overhead_percent\": " << decode_overhead
+                     << ", \"repeats\": " << runs << "}";
+                first = false;
+                continue;
+            }
+
+            std::cout << std::left << std::setw(12) << c.name << std::setw(6) << name << std::right << std::setw(12) << r.compressed
+                      << std::fixed << std::setprecision(3) << std::setw(8) << ratio << std::setprecision(2) << std::setw(12) << encode_speed
+                      << std::setw(12) << decode_speed << std::setw(12) << r.peak_rss << std::endl;
+
+            json << (first ? "\n" : ",\n") << "  {\"corpus\": \"" << c.name << "\", \"codec\": \"" << name << "\", \"input_bytes\": " << data.size()
+                 << ", \"compressed_bytes\": " << r.compressed << ", \"ratio\": " << ratio << ", \"encode_mb_s\": " << encode_speed
+                 << ", \"decode_mb_s\": " << decode_speed << ", \"peak_rss_kib\": " << r.peak_rss << ", \"repeats\": " << runs << "}";
+            first = false;
+        }
+    }
+    json << "\n]\n";
+
+    if (stats)
+    {
+        /* Not into the JSON results on stdout: */
+        stats->print(json_filename == "-" ? std::cerr : std::cout);
+    }
+
+    if (!json_filename.empty())
+    {
+        if (json_filename == "-")
+        {
+            std::cout << json.str();
+        }
+        else
+        {
+            std::ofstream file(json_filename);
+            file << json.str();
+
+            if (!file)
+            {
+                std::cerr << "Error writing file " << json_filename << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
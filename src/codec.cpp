@@ -0,0 +1,86 @@
+#include "codec.hpp"
+#include "common.hpp"
+#include "lz77.hpp"
+#include "lzw.hpp"
+
+void comp::codec::compress(codec_id id, std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    switch (id)
+    {
+    case codec_id::shannon_fano:
+        common::shannon_fano_encode(in, out);
+        break;
+    case codec_id::huffman:
+        common::huffman_encode(in, out);
+        break;
+    case codec_id::lz77:
+        lz77::encode(in, out);
+        break;
+    case codec_id::lzw:
+        lzw::encode(in, out);
+        break;
+    }
+}
+
+bool comp::codec::decompress(codec_id id, std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    switch (id)
+    {
+    case codec_id::shannon_fano:
+    case codec_id::huffman:
+        return common::decode(in, out);
+    case codec_id::lz77:
+        return lz77::decode(in, out);
+    case codec_id::lzw:
+        return lzw::decode(in, out) == lzw::ok;
+    }
+
+    return false;
+}
+
+std::unique_ptr<comp::stream_coder> comp::codec::encoder(codec_id id)
+{
+    switch (id)
+    {
+    case codec_id::shannon_fano:
+        return common::shannon_fano_encoder();
+    case codec_id::huffman:
+        return common::huffman_encoder();
+    case codec_id::lz77:
+        return lz77::encoder();
+    case codec_id::lzw:
+        return lzw::encoder();
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<comp::stream_coder> comp::codec::decoder(codec_id id)
+{
+    switch (id)
+    {
+    case codec_id::shannon_fano:
+    case codec_id::huffman:
+        return common::block_decoder();
+    case codec_id::lz77:
+        return lz77::decoder();
+    case codec_id::lzw:
+        return lzw::decoder();
+    }
+
+    return nullptr;
+}
+
+const char *comp::codec::name(codec_id id)
+{
+    static const char *const names[count] = {"sf", "huf", "lz77", "lzw"};
+
+    return names[static_cast<size_t>(id)];
+}
+
+const std::string &comp::codec::ext(codec_id id)
+{
+    static const std::string *const exts[count] = {&common::sf_ext, &common::hf_ext, &lz77::ext, &lzw::ext};
+
+    return *exts[static_cast<size_t>(id)];
+}
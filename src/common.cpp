@@ -1,10 +1,13 @@
 #include "common.hpp"
+#include "file_io.hpp"
+#include "stats.hpp"
 
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <cstdint>
 #include <cstdlib>
+#include <climits>
 #include <cmath>
 #include <algorithm>
 #include <vector>
@@ -16,6 +19,9 @@
 const std::string comp::common::sf_ext = ".sfef";
 const std::string comp::common::hf_ext = ".hfef";
 
+/* Set in the length of a stored (uncoded) input; no input gets anywhere near that long: */
+const uint64_t stored_flag = 1ULL << 63;
+
 struct comp::common::_sf_data
 {
     uint8_t byte;
@@ -101,33 +107,47 @@ std::string comp::common::trim_string_ext(const std::string &str)
     return str;
 }
 
+/* Little endian: */
+static void put_length(std::vector<uint8_t> &out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
 void comp::common::_write_encoded(std::vector<std::pair<uint8_t, std::vector<bool>>> &result,
-                                  const std::string &filename, const std::string &output_filename)
+                                  std::span<const uint8_t> in, std::vector<uint8_t> &out)
 {
-    std::ifstream in(filename, std::ios::binary);
-    std::ofstream out(output_filename, std::ios::binary);
     /*
-     * Serialize into output_filename:
-     * 1. { prefix bit count | prefix + padding (mod 8 == 0) }, n times, n ASC
-     * 2. { encoded contents }
+     * Serialize into out:
+     * 1. { input length }, 64-bit little endian; the padding of the last byte is not mistaken for more codes
+     * 2. { prefix bit count | prefix + padding (mod 8 == 0) }, 256 times, bytes ASC; a count of 0 (no prefix) for bytes that do not occur
+     * 3. { encoded contents }
+     *
+     * Or, if coding does not pay: { input length | stored_flag } { input }
      */
+    std::vector<bool> bitmap[256];
 
-    /* 1. */
     for (auto &[b, vec] : result)
+    {
+        bitmap[b] = vec;
+    }
+
+    out.clear();
+
+    /* 1. */
+    put_length(out, in.size());
+
+    /* 2. */
+    for (auto &vec : bitmap)
     {
         uint8_t prefix_bit_count = static_cast<uint8_t>(vec.size());
-        out.write(reinterpret_cast<char *>(&prefix_bit_count), sizeof prefix_bit_count);
+        out.push_back(prefix_bit_count);
 
-        // TODO: Fix endianness issue!S!
-        uint8_t padded_prefix[256 / (sizeof(uint8_t) * CHAR_BIT)];
-        if (vec.size() == 0)
-        {
-            std::cout << "Fatal error: " << __LINE__ << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        uint8_t len_mod_8 = (((vec.size() - 1) / CHAR_BIT) + 1) * CHAR_BIT;
+        const size_t len_mod_8 = ((vec.size() + CHAR_BIT - 1) / CHAR_BIT) * CHAR_BIT;
 
-        int i;
+        size_t i;
         const uint8_t mask = 0x1;
         uint8_t byte = 0x0;
 
@@ -141,31 +161,19 @@ void comp::common::_write_encoded(std::vector<std::pair<uint8_t, std::vector<boo
             }
             if ((i + 1) % 8 == 0)
             {
-                out.write(reinterpret_cast<char *>(&byte), sizeof byte);
+                out.push_back(byte);
                 byte = 0x0;
             }
         }
     }
 
-    /* 2. */
-
-    if (!in.is_open())
-    {
-        std::cout << "Failed to open: " << filename << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    std::map<uint8_t, std::vector<bool>> bitmap(result.begin(), result.end());
-
-    uint8_t in_byte;
-    uint8_t out_byte;
+    /* 3. */
+    uint8_t out_byte = 0;
     uint8_t out_byte_bit_count = 0;
 
-    while (in.read(reinterpret_cast<char *>(&in_byte), sizeof in_byte))
+    for (uint8_t in_byte : in)
     {
-        std::vector<bool> prefix_bits = bitmap[in_byte];
-
-        for (bool pb : prefix_bits)
+        for (bool pb : bitmap[in_byte])
         {
             const uint8_t write_mask = (pb) ? 0x1 : 0x0;
             out_byte = out_byte | write_mask;
@@ -173,7 +181,7 @@ void comp::common::_write_encoded(std::vector<std::pair<uint8_t, std::vector<boo
 
             if (out_byte_bit_count == 8)
             {
-                out.write(reinterpret_cast<char *>(&out_byte), sizeof out_byte);
+                out.push_back(out_byte);
                 out_byte_bit_count = 0;
                 out_byte = 0;
             }
@@ -184,15 +192,75 @@ void comp::common::_write_encoded(std::vector<std::pair<uint8_t, std::vector<boo
         }
     }
 
-    /* Flush any remaining bits: */
+    /* Flush any remaining bits (already shifted once past the last one): */
     if (out_byte_bit_count)
     {
-        out_byte <<= (8 - out_byte_bit_count);
-        out.write(reinterpret_cast<char *>(&out_byte), sizeof out_byte);
+        out_byte <<= (7 - out_byte_bit_count);
+        out.push_back(out_byte);
     }
+}
+
+void comp::common::_encode(_code_function codes, std::span<const uint8_t> in, std::vector<uint8_t> &out, stats *s)
+{
+    /* Initialized to 0 by default: */
+    std::map<uint8_t, double> prob;
+    std::vector<std::pair<uint8_t, std::vector<bool>>> result;
+
+    stats::timer histogram(s, "histogram");
+    calc_prob(in, prob);
+    histogram.stop();
+
+    stats::timer table(s, "table build");
+    codes(prob, result);
+    table.stop();
 
-    in.close();
-    out.close();
+    /* The size is known exactly before coding, from the byte counts rather than the probabilities;
+     * incompressible input is copied instead: */
+    uint64_t count[256] = {};
+    uint64_t bits = 0, header = 8 + 256;
+
+    for (uint8_t byte : in)
+    {
+        count[byte]++;
+    }
+
+    for (auto &[byte, code] : result)
+    {
+        bits += count[byte] * code.size();
+        header += (code.size() + 7) / 8;
+    }
+
+    const bool store = header + (bits + 7) / 8 >= 8 + in.size();
+
+    stats::timer coding(s, "coding");
+    if (store)
+    {
+        out.clear();
+        put_length(out, in.size() | stored_flag);
+        out.insert(out.end(), in.begin(), in.end());
+    }
+    else
+    {
+        _write_encoded(result, in, out);
+    }
+    coding.stop();
+
+    if (s)
+    {
+        s->set("stored", store);
+        /* The code against the bound it can get to: */
+        double entropy = 0, length = 0;
+
+        for (auto &[byte, code] : result)
+        {
+            entropy -= prob[byte] * std::log2(prob[byte]);
+            length += prob[byte] * code.size();
+        }
+
+        s->set("symbols", result.size());
+        s->set("entropy_bits", entropy);
+        s->set("average_code_bits", length);
+    }
 }
 
 std::shared_ptr<comp::common::_node> comp::common::join_nodes(std::shared_ptr<comp::common::_node> left, std::shared_ptr<comp::common::_node> right)
@@ -229,10 +297,12 @@ void comp::common::_huffman_code_gen(std::shared_ptr<comp::common::_node> &node,
     prefix_buffer.pop_back();
 }
 
-void comp::common::huffman_encode(const std::string &filename)
+void comp::common::_huffman_codes(const std::map<uint8_t, double> &prob, std::vector<std::pair<uint8_t, std::vector<bool>>> &_result)
 {
-    std::map<uint8_t, double> prob;
-    comp::common::calc_prob(filename, prob);
+    if (prob.empty())
+    {
+        return;
+    }
 
     struct cmpPair
     {
@@ -285,45 +355,130 @@ void comp::common::huffman_encode(const std::string &filename)
     std::map<uint8_t, std::vector<bool>> codes;
     std::vector<bool> buf;
 
-    auto tree = std::make_shared<comp::common::_node>();
     _huffman_code_gen(root, buf, codes);
 
-    std::vector<std::pair<uint8_t, std::vector<bool>>> _result(codes.begin(), codes.end());
+    /* A lone byte is the root itself, and still needs a bit: */
+    if (codes.size() == 1)
+    {
+        codes.begin()->second = {false};
+    }
+
+    _result.assign(codes.begin(), codes.end());
+}
+
+void comp::common::huffman_encode(std::span<const uint8_t> in, std::vector<uint8_t> &out, stats *s)
+{
+    _encode(_huffman_codes, in, out, s);
+}
+
+bool comp::common::huffman_encode(const std::string &filename, stats *s)
+{
+    input_file in;
+    output_file out;
+    std::vector<uint8_t> encoded;
+
+    if (!in.open(filename) || !out.open(filename + hf_ext, &in))
+    {
+        return false;
+    }
+
+    stats::timer read(s, "read");
+    const std::span<const uint8_t> data = in.all();
+    read.stop();
+
+    if (in.failed())
+    {
+        return false;
+    }
+
+    huffman_encode(data, encoded, s);
 
-    const std::string output_filename = filename + hf_ext;
+    stats::timer write(s, "write");
+    if (!out.write(encoded) || !out.close())
+    {
+        return false;
+    }
+    write.stop();
 
-    _write_encoded(_result, filename, output_filename);
+    if (s)
+    {
+        s->set("input_bytes", data.size());
+        s->set("output_bytes", encoded.size());
+    }
+    return true;
 }
 
-void comp::common::decode(const std::string &filename)
+bool comp::common::decoded_size(std::span<const uint8_t> in, uint64_t &length)
+{
+    /* Input length: */
+    if (in.size() < 8)
+    {
+        return false;
+    }
+
+    length = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        length |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+
+    if (length & stored_flag)
+    {
+        length &= ~stored_flag;
+        return length == in.size() - 8;
+    }
+
+    /* Every byte costs at least one bit: */
+    return length / 8 <= in.size();
+}
+
+bool comp::common::decode(std::span<const uint8_t> in, std::span<uint8_t> out)
 {
-    // TODO what if the decoded filename already exists?
-    std::ifstream in(filename, std::ios::binary);
-    std::ofstream out(trim_string_ext(filename), std::ios::binary);
     // TODO auto
     auto trie = std::make_shared<_node>();
+    size_t pos = 8;
 
-    uint8_t valid_bits;
-    uint8_t byte;
+    uint64_t length;
+    if (!decoded_size(in, length) || out.size() != length)
+    {
+        return false;
+    }
+
+    if (in[7] & (stored_flag >> 56))
+    {
+        std::copy(in.begin() + 8, in.end(), out.begin());
+        return true;
+    }
 
     /* File header (prefixes): */
+    size_t symbols = 0;
     for (int i = 0; i < 256; i++)
     {
+        if (pos == in.size())
+        {
+            return false;
+        }
 
-        in.read(reinterpret_cast<char *>(&valid_bits), sizeof valid_bits);
+        const uint8_t valid_bits = in[pos++];
 
         const bool excess_bits = (valid_bits % 8) > 0;
         const uint8_t bytes_to_read = valid_bits / 8 + (excess_bits ? 1 : 0);
 
-        std::vector<bool> bits;
-        std::vector<uint8_t> bytes;
+        if (in.size() - pos < bytes_to_read)
+        {
+            return false;
+        }
 
-        for (int j = 0; j < bytes_to_read; j++)
+        /* Byte does not occur: */
+        if (valid_bits == 0)
         {
-            in.read(reinterpret_cast<char *>(&byte), sizeof byte);
-            bytes.push_back(byte);
+            continue;
         }
 
+        std::vector<bool> bits;
+        const uint8_t *bytes = &in[pos];
+        pos += bytes_to_read;
+
         uint8_t mask = 0x80;
         for (int j = 0; j < valid_bits; j++)
         {
@@ -335,49 +490,123 @@ void comp::common::decode(const std::string &filename)
                 mask = 0x80;
             }
         }
-        auto ptr = trie->insert(bits, static_cast<uint8_t>(i));
+        trie->insert(bits, static_cast<uint8_t>(i));
+        symbols++;
     }
 
+    /* Every byte costs at least one bit: */
+    if (length && (symbols == 0 || length / 8 > in.size() - pos))
+    {
+        return false;
+    }
+
+    size_t produced = 0;
+
     _node *t = trie.get();
-    uint8_t leftover = 0;
-    for (;;)
+    for (; pos < in.size() && produced < length; pos++)
     {
-        if (leftover == 0)
+        const uint8_t byte = in[pos];
+        uint8_t leftover = 8;
+
+        while (leftover && produced < length)
         {
-            if (!(in.read(reinterpret_cast<char *>(&byte), sizeof byte)))
+            t = t->find(byte, leftover);
+            if (t == nullptr)
             {
-                // TODO check excess (padded) bits handling at the end of the file
-                goto cleanup;
+                return false;
             }
-            leftover = 8;
-        }
 
-        t = t->find(byte, leftover);
-        if (t == NULL)
-        {
-            std::cout << "Fatal error: " << __LINE__ << std::endl;
+            if (t->ends)
+            {
+                out[produced++] = std::any_cast<uint8_t>(t->data);
+                t = trie.get();
+            }
         }
+    }
 
-        if (t->ends)
-        {
-            auto decoded = std::any_cast<uint8_t>(t->data);
-            out.write(reinterpret_cast<char *>(&(decoded)), sizeof decoded);
-            t = trie.get();
-        }
+    return produced == length;
+}
+
+bool comp::common::decode(std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    uint64_t length;
+
+    out.clear();
+    if (!decoded_size(in, length))
+    {
+        return false;
     }
 
-cleanup:
-    in.close();
-    out.close();
+    out.resize(length);
+    return decode(in, std::span<uint8_t>(out));
 }
 
-void comp::common::shannon_fano_encode(const std::string &filename)
+bool comp::common::decode(const std::string &filename, stats *s)
 {
-    /* Initialized to 0 by default: */
-    std::map<uint8_t, double> prob;
-    std::vector<std::pair<uint8_t, std::vector<bool>>> result;
+    input_file in;
+    output_file out;
+    uint64_t length;
+
+    if (!in.open(filename))
+    {
+        return false;
+    }
+
+    stats::timer read(s, "read");
+    const std::span<const uint8_t> data = in.all();
+    read.stop();
+
+    if (in.failed() || !decoded_size(data, length))
+    {
+        std::cerr << "Corrupt file " << filename << std::endl;
+        return false;
+    }
+
+    /* Only once the input is known to be ours. An existing file of the decoded name is replaced, unless it is the input: */
+    if (!out.open(trim_string_ext(filename), &in))
+    {
+        return false;
+    }
 
-    comp::common::calc_prob(filename, prob);
+    /* The decoded size is known up front, decode straight into the output file: */
+    std::span<uint8_t> mapped = out.map(length);
+    std::vector<uint8_t> buffer;
+
+    if (mapped.size() != length)
+    {
+        buffer.resize(length);
+        mapped = buffer;
+    }
+
+    stats::timer decoding(s, "decoding");
+    if (!decode(data, mapped))
+    {
+        std::cerr << "Corrupt file " << filename << std::endl;
+        return false;
+    }
+    decoding.stop();
+
+    stats::timer write(s, "write");
+    if (!out.write(buffer) || !out.close())
+    {
+        return false;
+    }
+    write.stop();
+
+    if (s)
+    {
+        s->set("input_bytes", data.size());
+        s->set("output_bytes", length);
+    }
+    return true;
+}
+
+void comp::common::_shannon_fano_codes(const std::map<uint8_t, double> &prob, std::vector<std::pair<uint8_t, std::vector<bool>>> &result)
+{
+    if (prob.empty())
+    {
+        return;
+    }
 
     /* Convert to a vector, for sorting: */
     std::vector<std::pair<uint8_t, double>> vec(prob.begin(), prob.end());
@@ -403,16 +632,60 @@ void comp::common::shannon_fano_encode(const std::string &filename)
 
     comp::common::_shannon_fano(dat, l, r, 1);
 
+    /* A lone byte is never split, and still needs a bit: */
+    if (dat.size() == 1)
+    {
+        dat[0].prefix = {false};
+    }
+
     for (_sf_data t : dat)
     {
         result.push_back(std::pair<uint8_t, std::vector<bool>>(t.byte, t.prefix));
     }
 
     std::sort(result.begin(), result.end(), std::less<std::pair<double, std::vector<bool>>>());
+}
 
-    const std::string output_filename = filename + comp::common::sf_ext;
+void comp::common::shannon_fano_encode(std::span<const uint8_t> in, std::vector<uint8_t> &out, stats *s)
+{
+    _encode(_shannon_fano_codes, in, out, s);
+}
+
+bool comp::common::shannon_fano_encode(const std::string &filename, stats *s)
+{
+    input_file in;
+    output_file out;
+    std::vector<uint8_t> encoded;
+
+    if (!in.open(filename) || !out.open(filename + sf_ext, &in))
+    {
+        return false;
+    }
 
-    _write_encoded(result, filename, output_filename);
+    stats::timer read(s, "read");
+    const std::span<const uint8_t> data = in.all();
+    read.stop();
+
+    if (in.failed())
+    {
+        return false;
+    }
+
+    shannon_fano_encode(data, encoded, s);
+
+    stats::timer write(s, "write");
+    if (!out.write(encoded) || !out.close())
+    {
+        return false;
+    }
+    write.stop();
+
+    if (s)
+    {
+        s->set("input_bytes", data.size());
+        s->set("output_bytes", encoded.size());
+    }
+    return true;
 }
 
 /* Split + build prefix */
@@ -427,8 +700,8 @@ void comp::common::_shannon_fano(std::vector<struct _sf_data> &dat, uint8_t p, u
 
     double sum = dat[p].prob;
 
-    /* lim + 1 at worst would still be within bounds */
-    while (lim < q && (fabs(sum + dat[lim + 1].prob - (s / 2)) < fabs(sum - (s / 2))))
+    /* Both halves keep at least one byte; lim + 1 at worst would still be within bounds */
+    while (lim + 1 < q && (fabs(sum + dat[lim + 1].prob - (s / 2)) < fabs(sum - (s / 2))))
     {
         lim++;
         sum += dat[lim].prob;
@@ -449,32 +722,176 @@ void comp::common::_shannon_fano(std::vector<struct _sf_data> &dat, uint8_t p, u
     comp::common::_shannon_fano(dat, lim + 1, q, s - sum);
 }
 
-void comp::common::calc_prob(std::string filename, std::map<uint8_t, double> &prob)
+void comp::common::calc_prob(std::span<const uint8_t> in, std::map<uint8_t, double> &prob)
 {
-    std::map<uint8_t, int> bytes;
-    std::ifstream in(filename, std::ios::binary);
+    uint64_t bytes[256] = {};
 
-    if (!in.is_open())
+    for (uint8_t t : in)
     {
-        std::cout << "Failed to open: " << filename << std::endl;
-        exit(EXIT_FAILURE);
+        bytes[t]++;
     }
 
-    uint8_t t;
-    uint64_t total = 0;
+    for (int byte = 0; byte < 256; byte++)
+    {
+        if (bytes[byte])
+        {
+            prob[byte] = static_cast<double>(bytes[byte]) / in.size();
+        }
+    }
+}
 
-    while (in.read(reinterpret_cast<char *>(&t), sizeof t))
+bool comp::common::calc_prob(const std::string &filename, std::map<uint8_t, double> &prob, stats *s)
+{
+    input_file in;
+
+    if (!in.open(filename))
     {
-        bytes[t]++;
-        total++;
+        return false;
+    }
+
+    stats::timer read(s, "read");
+    const std::span<const uint8_t> data = in.all();
+    read.stop();
+
+    stats::timer histogram(s, "histogram");
+    calc_prob(data, prob);
+    histogram.stop();
+
+    if (s)
+    {
+        s->set("input_bytes", data.size());
+        s->set("symbols", prob.size());
     }
+    return !in.failed();
+}
+
+/* Gathers a block, then codes it as a whole: */
+class block_encoder : public comp::stream_coder
+{
+public:
+    typedef void (*encode_function)(std::span<const uint8_t>, std::vector<uint8_t> &, comp::stats *);
 
-    in.close();
+    block_encoder(encode_function f) : encode(f)
+    {
+        block.reserve(comp::common::block_size);
+    }
 
-    for (auto &[byte, count] : bytes)
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
     {
-        prob[byte] = static_cast<double>(count) / total;
+        for (consumed = 0; consumed < in.size();)
+        {
+            if (full())
+            {
+                return output_full;
+            }
+
+            const size_t n = std::min(in.size() - consumed, comp::common::block_size - block.size());
+            block.insert(block.end(), in.begin() + consumed, in.begin() + consumed + n);
+            consumed += n;
+
+            if (block.size() == comp::common::block_size)
+            {
+                flush();
+            }
+        }
+
+        return need_input;
     }
+
+    status finish() override
+    {
+        if (!block.empty())
+        {
+            flush();
+        }
+
+        finished = true;
+        return pending_or(done);
+    }
+
+private:
+    encode_function encode;
+    std::vector<uint8_t> block, encoded;
+
+    void flush()
+    {
+        encode(block, encoded, nullptr);
+
+        for (int i = 0; i < 4; i++)
+        {
+            output.push_back(static_cast<uint8_t>(encoded.size() >> (8 * i)));
+        }
+        output.insert(output.end(), encoded.begin(), encoded.end());
+
+        block.clear();
+    }
+};
+
+class block_decoder : public comp::stream_coder
+{
+public:
+    /* Largest encoded block accepted; a damaged size would otherwise ask for any amount of memory: */
+    static const size_t max_encoded = 4 * comp::common::block_size + 256 * 33 + 8;
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        for (consumed = 0; consumed < in.size() && !failed;)
+        {
+            if (full())
+            {
+                return output_full;
+            }
+
+            if (size_bytes < 4)
+            {
+                size |= static_cast<size_t>(in[consumed++]) << (8 * size_bytes++);
+                failed = (size_bytes == 4) && (size > max_encoded);
+                continue;
+            }
+
+            const size_t n = std::min(in.size() - consumed, size - block.size());
+            block.insert(block.end(), in.begin() + consumed, in.begin() + consumed + n);
+            consumed += n;
+
+            if (block.size() == size)
+            {
+                failed = !comp::common::decode(block, decoded) || decoded.size() > comp::common::block_size;
+                output.insert(output.end(), decoded.begin(), decoded.end());
+
+                block.clear();
+                size = size_bytes = 0;
+            }
+        }
+
+        return failed ? corrupt : need_input;
+    }
+
+    status finish() override
+    {
+        failed = failed || size_bytes != 0;
+        finished = true;
+
+        return pending_or(done);
+    }
+
+private:
+    size_t size = 0, size_bytes = 0;
+    std::vector<uint8_t> block, decoded;
+};
+
+std::unique_ptr<comp::stream_coder> comp::common::shannon_fano_encoder()
+{
+    return std::make_unique<block_encoder>(static_cast<block_encoder::encode_function>(&shannon_fano_encode));
+}
+
+std::unique_ptr<comp::stream_coder> comp::common::huffman_encoder()
+{
+    return std::make_unique<block_encoder>(static_cast<block_encoder::encode_function>(&huffman_encode));
+}
+
+std::unique_ptr<comp::stream_coder> comp::common::block_decoder()
+{
+    return std::make_unique<::block_decoder>();
 }
 
 comp::Buffer::Buffer(uint8_t sz) : maxbufsize(sz), buf(std::make_unique<uint8_t[]>(sz)) {}
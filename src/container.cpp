@@ -0,0 +1,314 @@
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <algorithm>
+
+#include "container.hpp"
+#include "estimate.hpp"
+#include "seekable.hpp"
+#include "stats.hpp"
+
+const std::string comp::container::ext = ".cmp";
+
+const uint8_t magic[] = {'C', 'M', 'P'};
+
+/* Above this share of repeated 8-byte strings, a dictionary coder wins over order-0 coding.
+ * Order-0 sources stay near 0 down to about 2.5 bits per byte; text and structured data measure 0.3 and up: */
+const double string_density = 0.1;
+
+/* Huffman codes take a bit per byte at least; below this entropy, runs pay more than codes: */
+const double low_entropy = 1.5;
+
+/* Passes everything on to the codec's coder, once there is one, and takes its output in turn. */
+class relay : public comp::stream_coder
+{
+protected:
+    std::unique_ptr<comp::stream_coder> inner;
+
+    /* `limited` false takes all of `in` whatever is waiting to be drained: */
+    status forward(std::span<const uint8_t> in, size_t &consumed, bool limited = true)
+    {
+        for (consumed = 0; consumed < in.size() && !failed;)
+        {
+            if (limited && full())
+            {
+                return output_full;
+            }
+
+            size_t n;
+            failed = inner->feed(in.subspan(consumed), n) == corrupt;
+            consumed += n;
+            take();
+        }
+
+        return failed ? corrupt : need_input;
+    }
+
+    status finish_inner()
+    {
+        if (!finished)
+        {
+            failed = failed || inner->finish() == corrupt;
+            take();
+            finished = true;
+        }
+
+        return pending_or(done);
+    }
+
+private:
+    void take()
+    {
+        size_t written;
+
+        do
+        {
+            const size_t old = output.size();
+
+            output.resize(old + output_limit);
+            failed = inner->drain(std::span<uint8_t>(output.data() + old, output_limit), written) == corrupt || failed;
+            output.resize(old + written);
+        } while (written);
+    }
+};
+
+class container_encoder : public relay
+{
+public:
+    /* Automatic: */
+    container_encoder(comp::stats *timing) : timing(timing) {}
+
+    container_encoder(comp::codec_id id, comp::stats *timing) : timing(timing)
+    {
+        start(id);
+    }
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        consumed = 0;
+
+        if (!inner)
+        {
+            consumed = std::min(in.size(), comp::container::sample_size - sample.size());
+            sample.insert(sample.end(), in.begin(), in.begin() + consumed);
+
+            if (sample.size() < comp::container::sample_size)
+            {
+                return need_input;
+            }
+            choose();
+        }
+
+        size_t n;
+        const status s = forward(in.subspan(consumed), n);
+        consumed += n;
+        return s;
+    }
+
+    status finish() override
+    {
+        if (!inner)
+        {
+            choose();
+        }
+
+        return finish_inner();
+    }
+
+private:
+    comp::stats *const timing;
+    std::vector<uint8_t> sample;
+
+    void choose()
+    {
+        comp::stats::timer t(timing, "codec choice");
+        const comp::codec_id id = comp::container::choose(sample);
+
+        t.stop();
+        start(id);
+    }
+
+    void start(comp::codec_id id)
+    {
+        if (timing)
+        {
+            timing->set("codec", static_cast<double>(id));
+        }
+
+        comp::container::put_header(output, id, comp::container::plain_version);
+        inner = comp::codec::encoder(id);
+
+        /* Held back input goes first, past the output limit this once: */
+        size_t n;
+        forward(sample, n, false);
+        sample = std::vector<uint8_t>();
+    }
+};
+
+class container_decoder : public relay
+{
+public:
+    container_decoder(comp::stats *timing) : timing(timing) {}
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        consumed = 0;
+
+        while (!inner && consumed < in.size())
+        {
+            header[size++] = in[consumed++];
+
+            if (size == comp::container::header_size)
+            {
+                comp::codec_id id;
+                uint8_t version;
+                bool checksums;
+
+                if (!comp::container::identify(std::span<const uint8_t>(header, size), id, version, checksums))
+                {
+                    failed = true;
+                    return corrupt;
+                }
+
+                if (timing)
+                {
+                    timing->set("codec", static_cast<double>(id));
+                }
+                inner = (version == comp::container::seekable_version) ? comp::seekable::decoder(id, checksums) : comp::codec::decoder(id);
+            }
+        }
+
+        if (!inner)
+        {
+            return failed ? corrupt : need_input;
+        }
+
+        size_t n;
+        const status s = forward(in.subspan(consumed), n);
+        consumed += n;
+        return s;
+    }
+
+    status finish() override
+    {
+        if (!inner)
+        {
+            failed = true;
+            finished = true;
+            return corrupt;
+        }
+
+        return finish_inner();
+    }
+
+private:
+    comp::stats *const timing;
+    uint8_t header[comp::container::header_size];
+    size_t size = 0;
+};
+
+comp::codec_id comp::container::choose(std::span<const uint8_t> in)
+{
+    if (in.empty())
+    {
+        return codec_id::lz77;
+    }
+
+    const size_t block = std::min(in.size(), estimate::slices * estimate::slice_size * 16);
+    const size_t blocks = std::max<size_t>(1, std::min(sample_blocks, in.size() / std::max<size_t>(block, 1)));
+    const size_t step = (blocks > 1) ? (in.size() - block) / (blocks - 1) : 0;
+
+    double entropy = 0, density = 0;
+    size_t incompressible = 0;
+
+    for (size_t i = 0; i < blocks; i++)
+    {
+        const std::span<const uint8_t> b = in.subspan(i * step, block);
+
+        entropy += estimate::entropy(b);
+        density += estimate::match_density(b, 8);
+        incompressible += estimate::incompressible(b);
+    }
+    entropy /= blocks;
+    density /= blocks;
+
+    if (incompressible == blocks)
+    {
+        return codec_id::lz77;
+    }
+
+    if (density > string_density || entropy < low_entropy)
+    {
+        return codec_id::lzw;
+    }
+
+    return codec_id::huffman;
+}
+
+void comp::container::compress(std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    compress(choose(in), in, out);
+}
+
+void comp::container::compress(codec_id id, std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    out.clear();
+    container_encoder(id, nullptr).run(in, out);
+}
+
+bool comp::container::decompress(std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    out.clear();
+    return container_decoder(nullptr).run(in, out) == stream_coder::done;
+}
+
+std::unique_ptr<comp::stream_coder> comp::container::encoder(stats *timing)
+{
+    return std::make_unique<container_encoder>(timing);
+}
+
+std::unique_ptr<comp::stream_coder> comp::container::encoder(codec_id id, stats *timing)
+{
+    return std::make_unique<container_encoder>(id, timing);
+}
+
+std::unique_ptr<comp::stream_coder> comp::container::decoder(stats *timing)
+{
+    return std::make_unique<container_decoder>(timing);
+}
+
+void comp::container::put_header(std::vector<uint8_t> &out, codec_id id, uint8_t version, bool checksums)
+{
+    out.insert(out.end(), magic, magic + sizeof(magic));
+    out.push_back(version);
+    out.push_back(static_cast<uint8_t>(id) | (checksums ? checksum_flag : 0));
+}
+
+bool comp::container::identify(std::span<const uint8_t> in, codec_id &id)
+{
+    uint8_t version;
+    bool checksums;
+    return identify(in, id, version, checksums);
+}
+
+bool comp::container::identify(std::span<const uint8_t> in, codec_id &id, uint8_t &version, bool &checksums)
+{
+    if (in.size() < header_size || !std::equal(magic, magic + sizeof(magic), in.begin()) ||
+        (in[sizeof(magic)] != plain_version && in[sizeof(magic)] != seekable_version))
+    {
+        return false;
+    }
+
+    version = in[sizeof(magic)];
+    checksums = in[sizeof(magic) + 1] & checksum_flag;
+
+    /* Only blocks have checksums: */
+    const uint8_t codec_byte = in[sizeof(magic) + 1] & ~checksum_flag;
+    if (codec_byte >= codec::count || (checksums && version != seekable_version))
+    {
+        return false;
+    }
+
+    id = static_cast<codec_id>(codec_byte);
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "ldpc.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/* Whole symbols at a time; GCC turns this into vector XORs. */
+static void xor_into(uint8_t *to, const uint8_t *from, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        to[i] ^= from[i];
+    }
+}
+
+/*
+ * 1. Peeling. Every check keeps the number of its erased symbols, and the XOR of their indices, so when a single one is left
+ *    it is known without a scan. Checks down to one erasure are queued; resolving that symbol (the XOR of the check's other symbols)
+ *    decrements its other checks, which may queue them in turn. Every check is resolved at most once: O(edges) symbol XORs in total.
+ * 2. What is left is a stopping set: every remaining check has two erasures or more. Gaussian elimination over GF(2) on those
+ *    checks, restricted to the erased columns, with the known symbols folded into the right-hand side.
+ */
+size_t comp::ldpc::erasure_decode(const tanner_graph &g, uint8_t *symbols, size_t symbol_size, std::vector<uint8_t> &erased, bool *eliminated)
+{
+    const size_t num_checks = g.num_checks();
+
+    std::vector<uint32_t> count(num_checks, 0), index(num_checks, 0);
+    std::vector<uint32_t> queue;
+
+    if (eliminated)
+    {
+        *eliminated = false;
+    }
+
+    size_t left = 0;
+    for (size_t v = 0; v < g.num_bits(); v++)
+    {
+        if (!erased[v])
+        {
+            continue;
+        }
+
+        left++;
+        for (uint32_t i = g.var_ptr[v]; i < g.var_ptr[v + 1]; i++)
+        {
+            const uint32_t check = g.edge_check[g.var_edge[i]];
+
+            count[check]++;
+            index[check] ^= v;
+        }
+    }
+
+    for (uint32_t check = 0; check < num_checks; check++)
+    {
+        if (count[check] == 1)
+        {
+            queue.push_back(check);
+        }
+    }
+
+    /* 1. */
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        const uint32_t check = queue[head];
+
+        /* Already resolved by another check: */
+        if (count[check] != 1)
+        {
+            continue;
+        }
+
+        const uint32_t v = index[check];
+        uint8_t *symbol = symbols + v * symbol_size;
+
+        std::memset(symbol, 0, symbol_size);
+        for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+        {
+            if (g.edge_var[e] != v)
+            {
+                xor_into(symbol, symbols + g.edge_var[e] * symbol_size, symbol_size);
+            }
+        }
+
+        erased[v] = 0;
+        left--;
+
+        for (uint32_t i = g.var_ptr[v]; i < g.var_ptr[v + 1]; i++)
+        {
+            const uint32_t other = g.edge_check[g.var_edge[i]];
+
+            index[other] ^= v;
+            if (--count[other] == 1)
+            {
+                queue.push_back(other);
+            }
+        }
+    }
+
+    if (left == 0)
+    {
+        return 0;
+    }
+
+    if (eliminated)
+    {
+        *eliminated = true;
+    }
+
+    /* 2. Columns are the erased symbols, rows the checks still touching them: */
+    std::vector<uint32_t> columns, rows;
+    std::vector<uint32_t> column_of(g.num_bits(), 0);
+
+    for (uint32_t v = 0; v < g.num_bits(); v++)
+    {
+        if (erased[v])
+        {
+            column_of[v] = columns.size();
+            columns.push_back(v);
+        }
+    }
+
+    for (uint32_t check = 0; check < num_checks; check++)
+    {
+        if (count[check])
+        {
+            rows.push_back(check);
+        }
+    }
+
+    const size_t row_words = (columns.size() + 63) / 64;
+    std::vector<uint64_t> matrix(rows.size() * row_words, 0);
+    std::vector<uint8_t> rhs(rows.size() * symbol_size, 0);
+
+    for (size_t r = 0; r < rows.size(); r++)
+    {
+        for (uint32_t e = g.check_ptr[rows[r]]; e < g.check_ptr[rows[r] + 1]; e++)
+        {
+            const uint32_t v = g.edge_var[e];
+
+            if (erased[v])
+            {
+                matrix[r * row_words + column_of[v] / 64] ^= 1ULL << (column_of[v] % 64);
+            }
+            else
+            {
+                xor_into(&rhs[r * symbol_size], symbols + v * symbol_size, symbol_size);
+            }
+        }
+    }
+
+    /* Reduced row echelon form; `pivot_row[c]` is the row that pivots on column `c`, if any: */
+    const uint32_t none = rows.size();
+    std::vector<uint32_t> pivot_row(columns.size(), none);
+    size_t rank = 0;
+
+    for (size_t c = 0; c < columns.size() && rank < rows.size(); c++)
+    {
+        const uint64_t mask = 1ULL << (c % 64);
+
+        size_t r = rank;
+        while (r < rows.size() && !(matrix[r * row_words + c / 64] & mask))
+        {
+            r++;
+        }
+
+        if (r == rows.size())
+        {
+            continue;
+        }
+
+        if (r != rank)
+        {
+            std::swap_ranges(&matrix[r * row_words], &matrix[(r + 1) * row_words], &matrix[rank * row_words]);
+            std::swap_ranges(&rhs[r * symbol_size], &rhs[(r + 1) * symbol_size], &rhs[rank * symbol_size]);
+        }
+
+        for (size_t other = 0; other < rows.size(); other++)
+        {
+            if (other != rank && (matrix[other * row_words + c / 64] & mask))
+            {
+                for (size_t w = c / 64; w < row_words; w++)
+                {
+                    matrix[other * row_words + w] ^= matrix[rank * row_words + w];
+                }
+                xor_into(&rhs[other * symbol_size], &rhs[rank * symbol_size], symbol_size);
+            }
+        }
+
+        pivot_row[c] = rank++;
+    }
+
+    /* A pivot is solved when its row has no other column left, i.e. none without a pivot: */
+    for (size_t c = 0; c < columns.size(); c++)
+    {
+        if (pivot_row[c] == none)
+        {
+            continue;
+        }
+
+        const uint64_t *row = &matrix[pivot_row[c] * row_words];
+        bool alone = true;
+
+        for (size_t w = 0; w < row_words && alone; w++)
+        {
+            alone = row[w] == ((w == c / 64) ? (1ULL << (c % 64)) : 0);
+        }
+
+        if (alone)
+        {
+            std::memcpy(symbols + columns[c] * symbol_size, &rhs[pivot_row[c] * symbol_size], symbol_size);
+            erased[columns[c]] = 0;
+            left--;
+        }
+    }
+
+    return left;
+}
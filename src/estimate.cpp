@@ -0,0 +1,88 @@
+#include "estimate.hpp"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+/* Above this (bits per byte), order-0 coding gains next to nothing; a sample of 4 KiB of random bytes measures about 7.95: */
+const double entropy_limit = 7.6;
+
+/* Below this, repeats are too rare for a dictionary coder to pay for its codes: */
+const double density_limit = 0.01;
+
+const size_t hash_bits = 12;
+
+/* Calls `fn` on every slice of the sample: */
+template <typename F>
+static void sample(std::span<const uint8_t> in, F fn)
+{
+    const size_t total = comp::estimate::slices * comp::estimate::slice_size;
+
+    if (in.size() <= total)
+    {
+        fn(in);
+        return;
+    }
+
+    const size_t step = (in.size() - comp::estimate::slice_size) / (comp::estimate::slices - 1);
+    for (size_t i = 0; i < comp::estimate::slices; i++)
+    {
+        fn(in.subspan(i * step, comp::estimate::slice_size));
+    }
+}
+
+double comp::estimate::entropy(std::span<const uint8_t> in)
+{
+    uint32_t count[256] = {};
+    size_t total = 0;
+
+    sample(in, [&](std::span<const uint8_t> slice)
+           {
+        for (uint8_t byte : slice)
+        {
+            count[byte]++;
+        }
+        total += slice.size(); });
+
+    double h = 0;
+    for (uint32_t c : count)
+    {
+        if (c)
+        {
+            const double p = static_cast<double>(c) / total;
+            h -= p * std::log2(p);
+        }
+    }
+    return h;
+}
+
+double comp::estimate::match_density(std::span<const uint8_t> in, size_t length)
+{
+    /* The bytes last seen in every bucket, 0 for none (a run of zeros matches anyway, as it should): */
+    std::vector<uint64_t> table(1 << hash_bits, 0);
+    size_t probes = 0, hits = 0;
+
+    sample(in, [&](std::span<const uint8_t> slice)
+           {
+        for (size_t i = 0; i + length <= slice.size(); i++)
+        {
+            uint64_t v = 0;
+            for (size_t j = 0; j < length; j++)
+            {
+                v |= static_cast<uint64_t>(slice[i + j]) << (8 * j);
+            }
+
+            uint64_t &entry = table[(v * 0x9E3779B97F4A7C15ULL) >> (64 - hash_bits)];
+
+            hits += (entry == v);
+            entry = v;
+            probes++;
+        } });
+
+    return probes ? static_cast<double>(hits) / probes : 0;
+}
+
+bool comp::estimate::incompressible(std::span<const uint8_t> in)
+{
+    return !in.empty() && entropy(in) > entropy_limit && match_density(in) < density_limit;
+}
@@ -0,0 +1,477 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "file_io.hpp"
+
+/* Page size is the alignment O_DIRECT and the page cache like: */
+const size_t alignment = 4096;
+
+comp::input_file::~input_file()
+{
+    if (map)
+    {
+        munmap(const_cast<uint8_t *>(map), map_size);
+    }
+    if (fd > STDIN_FILENO)
+    {
+        ::close(fd);
+    }
+}
+
+bool comp::input_file::open(const std::string &filename)
+{
+    name = filename;
+    fd = (filename == "-") ? STDIN_FILENO : ::open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        std::cerr << "Error opening file " << filename << std::endl;
+        error = true;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        device = st.st_dev;
+        inode = st.st_ino;
+        is_mapped = true;
+        map_size = st.st_size;
+
+        /* mmap() refuses empty files; an empty mapping is just as good: */
+        if (map_size)
+        {
+            void *m = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (m == MAP_FAILED)
+            {
+                is_mapped = false;
+                map_size = 0;
+            }
+            else
+            {
+                map = static_cast<const uint8_t *>(m);
+                madvise(m, map_size, MADV_SEQUENTIAL);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool comp::input_file::same_file(int other) const
+{
+    struct stat st;
+
+    return inode != 0 && fstat(other, &st) == 0 && st.st_dev == device && st.st_ino == inode;
+}
+
+size_t comp::input_file::read_into(uint8_t *to, size_t size)
+{
+    /* Whatever peek() has read goes first: */
+    const size_t n = std::min(size, ahead.size() - ahead_pos);
+
+    if (n)
+    {
+        std::memcpy(to, ahead.data() + ahead_pos, n);
+        ahead_pos += n;
+
+        if (ahead_pos == ahead.size())
+        {
+            ahead.clear();
+            ahead_pos = 0;
+        }
+    }
+
+    return n + read_fd(to + n, size - n);
+}
+
+size_t comp::input_file::read_fd(uint8_t *to, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size && !error)
+    {
+        const ssize_t n = ::read(fd, to + done, size - done);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            std::cerr << "Error reading file " << name << std::endl;
+            error = true;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+
+        done += n;
+    }
+
+    return done;
+}
+
+std::span<const uint8_t> comp::input_file::all()
+{
+    if (is_mapped)
+    {
+        return next(map_size - pos);
+    }
+
+    buffer.clear();
+    for (;;)
+    {
+        const size_t old = buffer.size();
+        buffer.resize(old + block_size);
+
+        const size_t n = read_into(buffer.data() + old, block_size);
+        buffer.resize(old + n);
+
+        if (n < block_size)
+        {
+            return buffer;
+        }
+    }
+}
+
+std::span<const uint8_t> comp::input_file::next(size_t max)
+{
+    if (is_mapped)
+    {
+        const size_t n = std::min(max, map_size - pos);
+        std::span<const uint8_t> s(map + pos, n);
+
+        pos += n;
+        return s;
+    }
+
+    buffer.resize(max);
+    buffer.resize(read_into(buffer.data(), max));
+    return buffer;
+}
+
+std::span<const uint8_t> comp::input_file::peek(size_t max)
+{
+    if (is_mapped)
+    {
+        return std::span<const uint8_t>(map + pos, std::min(max, map_size - pos));
+    }
+
+    if (ahead.size() - ahead_pos < max)
+    {
+        ahead.erase(ahead.begin(), ahead.begin() + ahead_pos);
+        ahead_pos = 0;
+
+        const size_t old = ahead.size();
+        ahead.resize(max);
+        ahead.resize(old + read_fd(ahead.data() + old, max - old));
+    }
+
+    return std::span<const uint8_t>(ahead.data() + ahead_pos, std::min(max, ahead.size() - ahead_pos));
+}
+
+size_t comp::input_file::read(uint8_t *to, size_t max)
+{
+    if (is_mapped)
+    {
+        const std::span<const uint8_t> s = next(max);
+
+        std::memcpy(to, s.data(), s.size());
+        return s.size();
+    }
+
+    return read_into(to, max);
+}
+
+comp::output_file::~output_file()
+{
+    close();
+}
+
+bool comp::output_file::open(const std::string &filename, const input_file *input)
+{
+    name = filename;
+
+    /* Not truncated before it is known not to be the input: */
+    fd = (filename == "-") ? STDOUT_FILENO : ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+    {
+        std::cerr << "Error opening file " << filename << std::endl;
+        error = true;
+        return false;
+    }
+
+    if (input && input->same_file(fd))
+    {
+        std::cerr << "Output file " << filename << " is the input file" << std::endl;
+        ::close(fd);
+        fd = -1;
+        error = true;
+        return false;
+    }
+
+    struct stat st;
+    if (fd > STDOUT_FILENO && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && ftruncate(fd, 0) != 0)
+    {
+        std::cerr << "Error opening file " << filename << std::endl;
+        error = true;
+        return false;
+    }
+
+    buffer = static_cast<uint8_t *>(std::aligned_alloc(alignment, buffer_size));
+    return true;
+}
+
+bool comp::output_file::write_all(const uint8_t *data, size_t size)
+{
+    while (size && !error)
+    {
+        const ssize_t n = ::write(fd, data, size);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            error = true;
+            break;
+        }
+
+        data += n;
+        size -= n;
+    }
+
+    return !error;
+}
+
+bool comp::output_file::write(std::span<const uint8_t> data)
+{
+    if (data.empty())
+    {
+        return !error;
+    }
+
+    if (fd < 0 || mapping)
+    {
+        return false;
+    }
+
+    /* Top up the buffer first, so the file is written in whole blocks: */
+    if (buffered)
+    {
+        const size_t n = std::min(data.size(), buffer_size - buffered);
+
+        std::memcpy(buffer + buffered, data.data(), n);
+        buffered += n;
+        data = data.subspan(n);
+
+        if (buffered == buffer_size)
+        {
+            write_all(buffer, buffered);
+            buffered = 0;
+        }
+    }
+
+    /* Large writes skip the buffer: */
+    if (data.size() >= buffer_size)
+    {
+        return write_all(data.data(), data.size());
+    }
+
+    if (!data.empty())
+    {
+        std::memcpy(buffer + buffered, data.data(), data.size());
+        buffered += data.size();
+    }
+
+    return !error;
+}
+
+std::span<uint8_t> comp::output_file::map(size_t size)
+{
+    struct stat st;
+
+    if (fd < 0 || buffered || mapping || size == 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || ftruncate(fd, size) != 0)
+    {
+        return {};
+    }
+
+    void *m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED)
+    {
+        return {};
+    }
+
+    mapping = static_cast<uint8_t *>(m);
+    map_size = size;
+    return std::span<uint8_t>(mapping, size);
+}
+
+bool comp::output_file::close()
+{
+    if (fd < 0)
+    {
+        return !error;
+    }
+
+    if (buffered)
+    {
+        write_all(buffer, buffered);
+        buffered = 0;
+    }
+
+    if (mapping)
+    {
+        error = munmap(mapping, map_size) != 0 || error;
+        mapping = nullptr;
+    }
+
+    if (fd > STDOUT_FILENO)
+    {
+        error = ::close(fd) != 0 || error;
+    }
+    fd = -1;
+
+    std::free(buffer);
+    buffer = nullptr;
+
+    if (error)
+    {
+        std::cerr << "Error writing file " << name << std::endl;
+    }
+
+    return !error;
+}
+
+comp::read_ahead::read_ahead(input_file &in, size_t depth, size_t block_size) : ready(depth), spare(depth + 2)
+{
+    if (!in.mapped())
+    {
+        for (size_t i = 0; i < depth + 2; i++)
+        {
+            spare.push(std::vector<uint8_t>());
+        }
+    }
+
+    thread = std::thread([this, &in, block_size]()
+                         {
+        for (;;)
+        {
+            block b;
+
+            if (in.mapped())
+            {
+                b.data = in.next(block_size);
+
+                /* One read per page is enough to fault the block in: */
+                volatile uint8_t sink = 0;
+                for (size_t i = 0; i < b.data.size(); i += alignment)
+                {
+                    sink = sink + b.data[i];
+                }
+            }
+            else
+            {
+                if (!spare.pop(b.storage))
+                {
+                    break;
+                }
+
+                b.storage.resize(block_size);
+                b.storage.resize(in.read(b.storage.data(), block_size));
+                b.data = b.storage;
+            }
+
+            const bool last = b.data.empty();
+            if (!ready.push(std::move(b)) || last)
+            {
+                break;
+            }
+        }
+        ready.close(); });
+}
+
+comp::read_ahead::~read_ahead()
+{
+    /* Stop the reader, wherever it is: */
+    ready.close();
+    spare.close();
+    thread.join();
+}
+
+std::span<const uint8_t> comp::read_ahead::next()
+{
+    if (current.storage.capacity())
+    {
+        spare.push(std::move(current.storage));
+    }
+
+    if (ended || !ready.pop(current))
+    {
+        ended = true;
+        current = block();
+    }
+
+    return current.data;
+}
+
+comp::write_behind::write_behind(output_file &out, size_t depth) : queued(depth), spare(depth + 2)
+{
+    for (size_t i = 0; i < depth + 2; i++)
+    {
+        spare.push(std::vector<uint8_t>());
+    }
+
+    thread = std::thread([this, &out]()
+                         {
+        std::vector<uint8_t> data;
+
+        while (queued.pop(data))
+        {
+            out.write(data);
+
+            data.clear();
+            spare.push(std::move(data));
+        } });
+}
+
+comp::write_behind::~write_behind()
+{
+    finish();
+}
+
+std::vector<uint8_t> comp::write_behind::buffer()
+{
+    std::vector<uint8_t> data;
+
+    spare.pop(data);
+    return data;
+}
+
+void comp::write_behind::write(std::vector<uint8_t> &&data)
+{
+    queued.push(std::move(data));
+}
+
+void comp::write_behind::finish()
+{
+    queued.close();
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
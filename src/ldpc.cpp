@@ -0,0 +1,1962 @@
+#include "ldpc.hpp"
+#include "thread_pool.hpp"
+#include "checksum.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+const std::string comp::ldpc::ext = ".ldpc";
+
+/* Threshold, relative to the number of checks a bit participates in: */
+const double th = 0.5;
+
+/* Saved code header: magic, format version. */
+static const char ldpc_magic[] = {'L', 'D', 'P', 'C'};
+static const uint8_t ldpc_version = 1;
+
+/* Saved encoder header. Version 2 adds the hash of H (see graph_hash()): */
+static const char encoder_magic[] = {'L', 'D', 'P', 'E'};
+static const uint8_t encoder_version = 2;
+
+comp::Random::Random(uint64_t seed)
+{
+    /* splitmix64, so that similar seeds still give unrelated states: */
+    for (auto &word : s)
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        word = z ^ (z >> 31);
+    }
+}
+
+uint64_t comp::Random::next()
+{
+    auto rotl = [](uint64_t x, int k)
+    { return (x << k) | (x >> (64 - k)); };
+
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+uint32_t comp::Random::below(uint32_t bound)
+{
+    /* Multiply-shift instead of modulo; the bias is negligible for the bounds used here. */
+    return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+}
+
+double comp::Random::uniform()
+{
+    return ((next() >> 11) + 1) * 0x1.0p-53;
+}
+
+double comp::Random::normal()
+{
+    return std::sqrt(-2.0 * std::log(uniform())) * std::cos(2 * M_PI * uniform());
+}
+
+void comp::tanner_graph::build(uint32_t num_bits, const std::vector<std::vector<uint32_t>> &checks)
+{
+    check_ptr.assign(1, 0);
+    edge_var.clear();
+    edge_check.clear();
+
+    for (uint32_t c = 0; c < checks.size(); c++)
+    {
+        for (uint32_t v : checks[c])
+        {
+            edge_var.push_back(v);
+            edge_check.push_back(c);
+        }
+        check_ptr.push_back(edge_var.size());
+    }
+
+    /* Counting sort of the edges by variable: */
+    var_ptr.assign(num_bits + 1, 0);
+    for (uint32_t v : edge_var)
+    {
+        var_ptr[v + 1]++;
+    }
+    for (uint32_t j = 0; j < num_bits; j++)
+    {
+        var_ptr[j + 1] += var_ptr[j];
+    }
+
+    std::vector<uint32_t> fill(var_ptr.begin(), var_ptr.end() - 1);
+    var_edge.resize(edge_var.size());
+
+    for (uint32_t e = 0; e < edge_var.size(); e++)
+    {
+        var_edge[fill[edge_var[e]]++] = e;
+    }
+}
+
+size_t comp::tanner_graph::count_4_cycles() const
+{
+    /* Two checks sharing k variables form k * (k - 1) / 2 4-cycles: */
+    std::vector<uint32_t> shared(num_checks(), 0);
+    std::vector<uint32_t> touched;
+    size_t cycles = 0;
+
+    for (uint32_t c = 0; c < num_checks(); c++)
+    {
+        for (uint32_t e = check_ptr[c]; e < check_ptr[c + 1]; e++)
+        {
+            const uint32_t v = edge_var[e];
+
+            for (uint32_t i = var_ptr[v]; i < var_ptr[v + 1]; i++)
+            {
+                const uint32_t other = edge_check[var_edge[i]];
+
+                if (other > c && shared[other]++ == 0)
+                {
+                    touched.push_back(other);
+                }
+            }
+        }
+
+        for (uint32_t other : touched)
+        {
+            cycles += static_cast<size_t>(shared[other]) * (shared[other] - 1) / 2;
+            shared[other] = 0;
+        }
+        touched.clear();
+    }
+
+    return cycles;
+}
+
+void comp::tanner_graph::print() const
+{
+    std::vector<int> row(num_bits());
+
+    for (uint32_t c = 0; c < num_checks(); c++)
+    {
+        std::fill(row.begin(), row.end(), 0);
+        for (uint32_t e = check_ptr[c]; e < check_ptr[c + 1]; e++)
+        {
+            row[edge_var[e]] = 1;
+        }
+
+        for (int bit : row)
+        {
+            std::cout << bit << " ";
+        }
+        std::cout << std::endl;
+    }
+}
+
+/*
+ * Serialized code:
+ * 1. { magic | version | index width (2 or 4 bytes) | n | m }, n and m as 32-bit little endian
+ * 2. { check degree }, m times, 16-bit little endian
+ * 3. { variable index }, for every edge in row order, `index width` bytes little endian
+ */
+bool comp::tanner_graph::save(const std::string &filename) const
+{
+    std::vector<char> buf;
+
+    auto put = [&buf](uint32_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            buf.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    };
+
+    const uint8_t width = (num_bits() <= 0x10000) ? 2 : 4;
+
+    if (num_bits() > max_size || num_checks() > max_size)
+    {
+        return false;
+    }
+
+    for (uint32_t c = 0; c < num_checks(); c++)
+    {
+        if (check_ptr[c + 1] - check_ptr[c] > 0xFFFF)
+        {
+            return false;
+        }
+    }
+
+    buf.insert(buf.end(), std::begin(ldpc_magic), std::end(ldpc_magic));
+    buf.push_back(ldpc_version);
+    buf.push_back(width);
+    put(num_bits(), 4);
+    put(num_checks(), 4);
+
+    for (uint32_t c = 0; c < num_checks(); c++)
+    {
+        put(check_ptr[c + 1] - check_ptr[c], 2);
+    }
+
+    for (uint32_t v : edge_var)
+    {
+        put(v, width);
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    out.write(buf.data(), buf.size());
+
+    return static_cast<bool>(out);
+}
+
+bool comp::tanner_graph::load(const std::string &filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+
+    auto get = [&buf, &pos](int bytes, uint32_t &value)
+    {
+        if (pos + bytes > buf.size())
+        {
+            return false;
+        }
+
+        value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint32_t>(buf[pos++]) << (8 * i);
+        }
+        return true;
+    };
+
+    uint32_t magic, version, width, n, m;
+
+    if (!get(4, magic) || !std::equal(std::begin(ldpc_magic), std::end(ldpc_magic), buf.begin()) ||
+        !get(1, version) || version != ldpc_version ||
+        !get(1, width) || (width != 2 && width != 4) ||
+        !get(4, n) || !get(4, m) || n > max_size || m > max_size ||
+        buf.size() - pos < static_cast<size_t>(m) * 2)
+    {
+        return false;
+    }
+
+    /* Nothing is allocated for the edges until the file is known to hold them all: */
+    std::vector<uint32_t> degrees(m);
+    size_t edges = 0;
+    for (auto &degree : degrees)
+    {
+        get(2, degree);
+        edges += degree;
+    }
+
+    if (buf.size() - pos != edges * width)
+    {
+        return false;
+    }
+
+    std::vector<std::vector<uint32_t>> checks(m);
+    for (uint32_t c = 0; c < m; c++)
+    {
+        checks[c].resize(degrees[c]);
+        for (auto &v : checks[c])
+        {
+            if (!get(width, v) || v >= n)
+            {
+                return false;
+            }
+        }
+    }
+
+    build(n, checks);
+    return true;
+}
+
+bool comp::ldpc::gallager(tanner_graph &g, uint32_t n, uint32_t w_r, uint32_t w_c, uint64_t seed)
+{
+    if (n == 0 || w_r == 0 || w_c == 0 || n % w_r != 0)
+    {
+        return false;
+    }
+
+    const uint32_t rows = n / w_r;
+    std::vector<std::vector<uint32_t>> checks(rows * w_c);
+
+    /*
+    Write 1s:
+
+    111........0
+    0....111...0
+    0........111
+    ____________
+    ...
+
+    */
+    for (uint32_t j = 0; j < n; j++)
+    {
+        checks[j / w_r].push_back(j);
+    }
+
+    Random rng(seed);
+    std::vector<uint32_t> idx_shuffled(n);
+
+    for (uint32_t i = 1; i < w_c; i++)
+    {
+        for (uint32_t j = 0; j < n; j++)
+        {
+            idx_shuffled[j] = j;
+        }
+
+        /* Fisher-Yates: */
+        for (uint32_t j = n - 1; j > 0; j--)
+        {
+            std::swap(idx_shuffled[j], idx_shuffled[rng.below(j + 1)]);
+        }
+
+        /* Column j of block i is column idx_shuffled[j] of the first block: */
+        for (uint32_t j = 0; j < n; j++)
+        {
+            checks[i * rows + idx_shuffled[j] / w_r].push_back(j);
+        }
+    }
+
+    g.build(n, checks);
+    return true;
+}
+
+bool comp::ldpc::peg(tanner_graph &g, uint32_t n, uint32_t m, uint32_t w_c, uint64_t seed, uint32_t depth)
+{
+    std::vector<std::vector<uint32_t>> checks(m), vars(n);
+
+    /* Checks bucketed by their current degree, so the least used one is found without scanning all of them: */
+    std::vector<std::vector<uint32_t>> bucket(1);
+    std::vector<uint32_t> pos(m);
+
+    for (uint32_t c = 0; c < m; c++)
+    {
+        pos[c] = c;
+        bucket[0].push_back(c);
+    }
+
+    /* Neighbourhood marks; bumping `stamp` clears them: */
+    std::vector<uint32_t> check_seen(m, 0), var_seen(n, 0);
+    uint32_t stamp = 0;
+
+    std::vector<uint32_t> frontier, next;
+    Random rng(seed);
+
+    for (uint32_t v = 0; v < n; v++)
+    {
+        for (uint32_t k = 0; k < w_c; k++)
+        {
+            stamp++;
+            var_seen[v] = stamp;
+
+            frontier = vars[v];
+            for (uint32_t c : frontier)
+            {
+                check_seen[c] = stamp;
+            }
+            size_t covered = frontier.size();
+
+            /* Expand the neighbourhood level by level. Stop before it swallows every check,
+             * the new edge should then close the longest possible cycle: */
+            for (uint32_t level = 0; level < depth && !frontier.empty(); level++)
+            {
+                next.clear();
+                for (uint32_t c : frontier)
+                {
+                    for (uint32_t u : checks[c])
+                    {
+                        if (var_seen[u] == stamp)
+                        {
+                            continue;
+                        }
+                        var_seen[u] = stamp;
+
+                        for (uint32_t other : vars[u])
+                        {
+                            if (check_seen[other] != stamp)
+                            {
+                                check_seen[other] = stamp;
+                                next.push_back(other);
+                            }
+                        }
+                    }
+                }
+
+                if (covered + next.size() == m)
+                {
+                    for (uint32_t c : next)
+                    {
+                        check_seen[c] = 0;
+                    }
+                    break;
+                }
+
+                covered += next.size();
+                frontier.swap(next);
+            }
+
+            /* Least used check outside the neighbourhood, starting from a random position to break ties: */
+            uint32_t chosen = m;
+            for (auto &b : bucket)
+            {
+                if (b.empty())
+                {
+                    continue;
+                }
+
+                const uint32_t start = rng.below(b.size());
+                for (uint32_t i = 0; i < b.size() && chosen == m; i++)
+                {
+                    const uint32_t c = b[(start + i) % b.size()];
+                    if (check_seen[c] != stamp)
+                    {
+                        chosen = c;
+                    }
+                }
+
+                if (chosen != m)
+                {
+                    break;
+                }
+            }
+
+            /* Too dense: the variable has no free check left: */
+            if (chosen == m)
+            {
+                return false;
+            }
+
+            /* Move the chosen check one bucket up: */
+            const uint32_t degree = checks[chosen].size();
+            auto &from = bucket[degree];
+
+            from[pos[chosen]] = from.back();
+            pos[from.back()] = pos[chosen];
+            from.pop_back();
+
+            if (bucket.size() == degree + 1)
+            {
+                bucket.emplace_back();
+            }
+            pos[chosen] = bucket[degree + 1].size();
+            bucket[degree + 1].push_back(chosen);
+
+            checks[chosen].push_back(v);
+            vars[v].push_back(chosen);
+        }
+    }
+
+    g.build(n, checks);
+    return true;
+}
+
+/* Layer `l` is checks `l * m / layers` up to `(l + 1) * m / layers`; `layer_bits()` lists the bits each one touches.
+ * A single layer is the flooding schedule, and lists every bit. */
+static uint32_t layer_start(const comp::tanner_graph &g, uint32_t layers, uint32_t layer)
+{
+    return static_cast<uint32_t>(static_cast<uint64_t>(layer) * g.num_checks() / layers);
+}
+
+static std::vector<std::vector<uint32_t>> layer_bits(const comp::tanner_graph &g, uint32_t layers)
+{
+    std::vector<std::vector<uint32_t>> bits(layers);
+
+    if (layers == 1)
+    {
+        bits[0].resize(g.num_bits());
+        for (uint32_t v = 0; v < g.num_bits(); v++)
+        {
+            bits[0][v] = v;
+        }
+        return bits;
+    }
+
+    std::vector<uint32_t> stamp(g.num_bits(), layers);
+    for (uint32_t layer = 0; layer < layers; layer++)
+    {
+        for (uint32_t e = g.check_ptr[layer_start(g, layers, layer)]; e < g.check_ptr[layer_start(g, layers, layer + 1)]; e++)
+        {
+            const uint32_t v = g.edge_var[e];
+            if (stamp[v] != layer)
+            {
+                stamp[v] = layer;
+                bits[layer].push_back(v);
+            }
+        }
+    }
+
+    return bits;
+}
+
+/* The syndrome is computed once, O(edges), and afterwards only the checks of flipped bits are updated.
+ * Decoding ends as soon as every check is satisfied, so a valid frame costs a single syndrome check. */
+std::vector<int> comp::ldpc::gallager_b_decode(const tanner_graph &g, std::vector<int> received, int max_iterations, int *iterations, uint32_t layers)
+{
+    const size_t num_checks = g.num_checks();
+
+    layers = std::clamp<uint32_t>(layers, 1, std::max<size_t>(num_checks, 1));
+    const std::vector<std::vector<uint32_t>> candidates = layer_bits(g, layers);
+
+    std::vector<int> decoded = received;
+    std::vector<uint8_t> unsatisfied(num_checks);
+    std::vector<uint32_t> flipped;
+    size_t failing = 0;
+
+    for (size_t check = 0; check < num_checks; ++check)
+    {
+        int parity = 0;
+        for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+        {
+            parity ^= decoded[g.edge_var[e]];
+        }
+        unsatisfied[check] = parity;
+        failing += parity;
+    }
+
+    int iteration;
+    for (iteration = 0; failing && iteration < max_iterations; ++iteration)
+    {
+        /* Threshold & bit flip. A bit is flipped when the majority of its own checks fail, one of them in the current layer.
+         * All decisions of a layer are taken against the same syndrome, flips are applied before the next layer: */
+        bool any_flipped = false;
+
+        for (uint32_t layer = 0; layer < layers; layer++)
+        {
+            const uint32_t first = layer_start(g, layers, layer), last = layer_start(g, layers, layer + 1);
+
+            flipped.clear();
+            for (uint32_t bit : candidates[layer])
+            {
+                int checks_count = 0;
+                bool current = false;
+                for (uint32_t i = g.var_ptr[bit]; i < g.var_ptr[bit + 1]; i++)
+                {
+                    const uint32_t check = g.edge_check[g.var_edge[i]];
+
+                    checks_count += unsatisfied[check];
+                    current = current || (unsatisfied[check] && check >= first && check < last);
+                }
+
+                if (current && checks_count > th * (g.var_ptr[bit + 1] - g.var_ptr[bit]))
+                {
+                    flipped.push_back(bit);
+                }
+            }
+
+            any_flipped = any_flipped || !flipped.empty();
+
+            for (uint32_t bit : flipped)
+            {
+                decoded[bit] ^= 1;
+
+                for (uint32_t i = g.var_ptr[bit]; i < g.var_ptr[bit + 1]; i++)
+                {
+                    uint8_t &parity = unsatisfied[g.edge_check[g.var_edge[i]]];
+
+                    failing += parity ? -1 : 1;
+                    parity ^= 1;
+                }
+            }
+
+            /* No need to finish the iteration once every check is satisfied: */
+            if (!failing)
+            {
+                break;
+            }
+        }
+
+        /* Nothing left over to rectify, end: */
+        if (!any_flipped)
+        {
+            break;
+        }
+    }
+
+    if (iterations)
+    {
+        *iterations = iteration;
+    }
+
+    return decoded;
+}
+
+std::vector<uint64_t> comp::ldpc::gallager_b_decode_sliced(const tanner_graph &g, std::vector<uint64_t> &bits, size_t words, int max_iterations,
+                                                           std::vector<uint8_t> *iterations, uint32_t layers)
+{
+    const size_t num_bits = g.num_bits();
+    const size_t num_checks = g.num_checks();
+
+    layers = std::clamp<uint32_t>(layers, 1, std::max<size_t>(num_checks, 1));
+    const std::vector<std::vector<uint32_t>> candidates = layer_bits(g, layers);
+
+    std::vector<uint64_t> unsatisfied(num_checks * words);
+    std::vector<uint64_t> converged(words);
+
+    /* Bit-sliced vote counter: row `k` holds the frames in which at least `k` of the bit's checks fail. */
+    uint32_t max_degree = 0;
+    for (size_t bit = 0; bit < num_bits; ++bit)
+    {
+        max_degree = std::max(max_degree, g.var_ptr[bit + 1] - g.var_ptr[bit]);
+    }
+    std::vector<uint64_t> at_least((max_degree + 2) * words);
+
+    /* Frames whose iteration count has been recorded: */
+    std::vector<uint64_t> done(words, 0);
+    if (iterations)
+    {
+        iterations->assign(words * 64, 0);
+    }
+
+    /* Syndrome, computed from scratch only once: */
+    for (size_t check = 0; check < num_checks; ++check)
+    {
+        uint64_t *parity = &unsatisfied[check * words];
+        std::fill(parity, parity + words, 0);
+
+        for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+        {
+            const uint64_t *b = &bits[g.edge_var[e] * words];
+            for (size_t w = 0; w < words; w++)
+            {
+                parity[w] ^= b[w];
+            }
+        }
+    }
+
+    /* Flips of one layer, applied once every decision of the layer has been taken: */
+    size_t max_candidates = 0;
+    for (const auto &c : candidates)
+    {
+        max_candidates = std::max(max_candidates, c.size());
+    }
+    std::vector<uint64_t> flips(max_candidates * words), current(words);
+
+    int iteration;
+    for (iteration = 0;; ++iteration)
+    {
+        std::fill(converged.begin(), converged.end(), ~0ULL);
+
+        for (size_t check = 0; check < num_checks; ++check)
+        {
+            for (size_t w = 0; w < words; w++)
+            {
+                converged[w] &= ~unsatisfied[check * words + w];
+            }
+        }
+
+        if (iterations)
+        {
+            for (size_t w = 0; w < words; w++)
+            {
+                for (uint64_t fresh = converged[w] & ~done[w]; fresh; fresh &= fresh - 1)
+                {
+                    (*iterations)[w * 64 + __builtin_ctzll(fresh)] = iteration;
+                }
+                done[w] |= converged[w];
+            }
+        }
+
+        if (iteration == max_iterations || std::all_of(converged.begin(), converged.end(), [](uint64_t c)
+                                                       { return c == ~0ULL; }))
+        {
+            break;
+        }
+
+        /* Threshold & bit flip, layer by layer. A bit is flipped when more than `th` of its own checks fail, one of them
+         * in the current layer: */
+        uint64_t any_flipped = 0;
+        for (uint32_t layer = 0; layer < layers; layer++)
+        {
+            const uint32_t first = layer_start(g, layers, layer), last = layer_start(g, layers, layer + 1);
+            const std::vector<uint32_t> &layer_candidates = candidates[layer];
+
+            for (size_t j = 0; j < layer_candidates.size(); ++j)
+            {
+                const uint32_t bit = layer_candidates[j];
+                const uint32_t degree = g.var_ptr[bit + 1] - g.var_ptr[bit];
+                const uint32_t need = static_cast<uint32_t>(th * degree) + 1;
+
+                uint64_t *flip = &flips[j * words];
+
+                if (need > degree)
+                {
+                    std::fill(flip, flip + words, 0);
+                    continue;
+                }
+
+                /* Bits whose layer checks all hold cannot flip, skip the vote: */
+                std::fill(current.begin(), current.end(), 0);
+                for (uint32_t i = g.var_ptr[bit]; i < g.var_ptr[bit + 1]; i++)
+                {
+                    const uint32_t check = g.edge_check[g.var_edge[i]];
+                    if (check >= first && check < last)
+                    {
+                        for (size_t w = 0; w < words; w++)
+                        {
+                            current[w] |= unsatisfied[check * words + w];
+                        }
+                    }
+                }
+
+                if (std::all_of(current.begin(), current.end(), [](uint64_t c)
+                                { return c == 0; }))
+                {
+                    std::fill(flip, flip + words, 0);
+                    continue;
+                }
+
+                std::fill(at_least.begin(), at_least.begin() + words, ~0ULL);
+                std::fill(at_least.begin() + words, at_least.begin() + (need + 1) * words, 0);
+
+                for (uint32_t i = 0; i < degree; i++)
+                {
+                    const uint64_t *x = &unsatisfied[g.edge_check[g.var_edge[g.var_ptr[bit] + i]] * words];
+
+                    for (uint32_t k = std::min(need, i + 1); k > 0; k--)
+                    {
+                        uint64_t *row = &at_least[k * words];
+                        const uint64_t *below = &at_least[(k - 1) * words];
+
+                        for (size_t w = 0; w < words; w++)
+                        {
+                            row[w] |= below[w] & x[w];
+                        }
+                    }
+                }
+
+                for (size_t w = 0; w < words; w++)
+                {
+                    flip[w] = at_least[need * words + w] & current[w];
+                    any_flipped |= flip[w];
+                }
+            }
+
+            /* Apply the flips, and update only the checks of bits flipped in some frame: */
+            for (size_t j = 0; j < layer_candidates.size(); ++j)
+            {
+                const uint32_t bit = layer_candidates[j];
+                const uint64_t *flip = &flips[j * words];
+
+                uint64_t any = 0;
+                for (size_t w = 0; w < words; w++)
+                {
+                    any |= flip[w];
+                }
+
+                if (!any)
+                {
+                    continue;
+                }
+
+                uint64_t *b = &bits[bit * words];
+                for (size_t w = 0; w < words; w++)
+                {
+                    b[w] ^= flip[w];
+                }
+
+                for (uint32_t i = g.var_ptr[bit]; i < g.var_ptr[bit + 1]; i++)
+                {
+                    uint64_t *parity = &unsatisfied[g.edge_check[g.var_edge[i]] * words];
+                    for (size_t w = 0; w < words; w++)
+                    {
+                        parity[w] ^= flip[w];
+                    }
+                }
+            }
+
+            /* No need to finish the iteration once every frame satisfies every check: */
+            if (layer + 1 < layers && std::all_of(unsatisfied.begin(), unsatisfied.end(), [](uint64_t u)
+                                                  { return u == 0; }))
+            {
+                break;
+            }
+        }
+
+        /* Nothing left over to rectify, end: */
+        if (!any_flipped)
+        {
+            break;
+        }
+    }
+
+    /* Frames that never converged ran every iteration: */
+    if (iterations)
+    {
+        for (size_t w = 0; w < words; w++)
+        {
+            for (uint64_t left = ~done[w]; left; left &= left - 1)
+            {
+                (*iterations)[w * 64 + __builtin_ctzll(left)] = iteration;
+            }
+        }
+    }
+
+    return converged;
+}
+
+void comp::ldpc::slice(const std::vector<std::vector<int>> &frames, std::vector<uint64_t> &bits, size_t words)
+{
+    const size_t num_bits = frames.empty() ? 0 : frames[0].size();
+    bits.assign(num_bits * words, 0);
+
+    for (size_t f = 0; f < frames.size() && f < words * 64; f++)
+    {
+        for (size_t i = 0; i < num_bits; i++)
+        {
+            bits[i * words + f / 64] |= static_cast<uint64_t>(frames[f][i] & 0x1) << (f % 64);
+        }
+    }
+}
+
+void comp::ldpc::unslice(const std::vector<uint64_t> &bits, size_t words, std::vector<std::vector<int>> &frames)
+{
+    const size_t num_bits = bits.size() / words;
+
+    for (size_t f = 0; f < frames.size() && f < words * 64; f++)
+    {
+        frames[f].resize(num_bits);
+        for (size_t i = 0; i < num_bits; i++)
+        {
+            frames[f][i] = (bits[i * words + f / 64] >> (f % 64)) & 0x1;
+        }
+    }
+}
+
+/* One batch of the frame stream, packed/unpacked on the worker thread: */
+struct frame_batch
+{
+    size_t first;
+    size_t count;
+    std::vector<uint8_t> bytes;
+    std::vector<uint64_t> converged;
+    std::vector<uint8_t> iterations;
+};
+
+/* Decodes the `count` (at most 64 * `words`) frames of `bytes` in place: */
+static void decode_batch(const comp::tanner_graph &g, uint8_t *bytes, size_t count, size_t words, int max_iterations, uint32_t layers,
+                         std::vector<uint64_t> &converged, std::vector<uint8_t> &iterations)
+{
+    const size_t n = g.num_bits();
+    const size_t frame_bytes = (n + 7) / 8;
+
+    /* Missing frames stay all-zero, which is a codeword: */
+    std::vector<uint64_t> bits(n * words, 0);
+
+    for (size_t f = 0; f < count; f++)
+    {
+        const uint8_t *frame = &bytes[f * frame_bytes];
+        for (size_t i = 0; i < n; i++)
+        {
+            bits[i * words + f / 64] |= static_cast<uint64_t>((frame[i / 8] >> (7 - i % 8)) & 0x1) << (f % 64);
+        }
+    }
+
+    converged = comp::ldpc::gallager_b_decode_sliced(g, bits, words, max_iterations, &iterations, layers);
+
+    std::fill(bytes, bytes + count * frame_bytes, 0);
+    for (size_t f = 0; f < count; f++)
+    {
+        uint8_t *frame = &bytes[f * frame_bytes];
+        for (size_t i = 0; i < n; i++)
+        {
+            frame[i / 8] |= ((bits[i * words + f / 64] >> (f % 64)) & 0x1) << (7 - i % 8);
+        }
+    }
+}
+
+comp::frame_stats comp::ldpc::decode_frames(const tanner_graph &g, std::istream &in, std::ostream &out, std::ostream *report,
+                                            size_t threads, int max_iterations, uint32_t layers)
+{
+    const size_t words = 4;
+    const size_t batch_frames = words * 64;
+    const size_t n = g.num_bits();
+    const size_t frame_bytes = (n + 7) / 8;
+
+    ThreadPool pool(threads);
+
+    /* Batches in flight, oldest first; bounded so that memory does not depend on the input size: */
+    std::deque<std::pair<std::shared_ptr<frame_batch>, std::future<void>>> pending;
+    const size_t max_pending = 2 * pool.size();
+
+    frame_stats stats;
+    stats.iterations.assign(max_iterations + 1, 0);
+
+    auto retire = [&]()
+    {
+        auto [batch, done] = std::move(pending.front());
+        pending.pop_front();
+        done.get();
+
+        out.write(reinterpret_cast<const char *>(batch->bytes.data()), batch->count * frame_bytes);
+
+        for (size_t f = 0; f < batch->count; f++)
+        {
+            const bool converged = (batch->converged[f / 64] >> (f % 64)) & 0x1;
+
+            stats.converged += converged;
+            stats.iterations[batch->iterations[f]]++;
+
+            if (report)
+            {
+                *report << batch->first + f << "," << static_cast<int>(batch->iterations[f]) << "," << converged << "\n";
+            }
+        }
+    };
+
+    for (;;)
+    {
+        auto batch = std::make_shared<frame_batch>();
+        batch->bytes.resize(batch_frames * frame_bytes);
+
+        in.read(reinterpret_cast<char *>(batch->bytes.data()), batch->bytes.size());
+        batch->count = in.gcount() / frame_bytes;
+        batch->first = stats.frames;
+
+        if (batch->count == 0)
+        {
+            break;
+        }
+        stats.frames += batch->count;
+
+        auto task = [&g, batch, words, max_iterations, layers]()
+        {
+            decode_batch(g, batch->bytes.data(), batch->count, words, max_iterations, layers, batch->converged, batch->iterations);
+        };
+
+        pending.emplace_back(batch, pool.submit(task));
+
+        if (pending.size() >= max_pending)
+        {
+            retire();
+        }
+    }
+
+    while (!pending.empty())
+    {
+        retire();
+    }
+
+    return stats;
+}
+
+comp::frame_stats comp::ldpc::decode_frames(const tanner_graph &g, std::span<const uint8_t> in, std::vector<uint8_t> &out, int max_iterations,
+                                            uint32_t layers)
+{
+    const size_t words = 4;
+    const size_t batch_frames = words * 64;
+    const size_t frame_bytes = (g.num_bits() + 7) / 8;
+
+    frame_stats stats;
+    stats.frames = in.size() / frame_bytes;
+    stats.iterations.assign(max_iterations + 1, 0);
+
+    out.assign(in.begin(), in.begin() + stats.frames * frame_bytes);
+
+    std::vector<uint64_t> converged;
+    std::vector<uint8_t> iterations;
+
+    for (size_t first = 0; first < stats.frames; first += batch_frames)
+    {
+        const size_t count = std::min(batch_frames, stats.frames - first);
+
+        decode_batch(g, &out[first * frame_bytes], count, words, max_iterations, layers, converged, iterations);
+
+        for (size_t f = 0; f < count; f++)
+        {
+            stats.converged += (converged[f / 64] >> (f % 64)) & 0x1;
+            stats.iterations[iterations[f]]++;
+        }
+    }
+
+    return stats;
+}
+
+/* Encodes the first `length` bytes of `chunk` (64 * `words` messages of k bits, zero padded) into `frames`.
+ * Returns the number of frames, which only the last, short chunk has fewer than 64 * `words` of: */
+static size_t encode_batch(const comp::tanner_graph &g, const comp::systematic_encoder &enc, const uint8_t *chunk, size_t length, size_t words,
+                           std::vector<uint64_t> &message, std::vector<uint64_t> &bits, uint8_t *frames)
+{
+    const size_t n = g.num_bits();
+    const size_t k = enc.k();
+    const size_t frame_bytes = (n + 7) / 8;
+    const size_t count = (length * 8 + k - 1) / k;
+
+    message.assign(k * words, 0);
+
+    for (size_t f = 0; f < count; f++)
+    {
+        for (size_t j = 0; j < k; j++)
+        {
+            const size_t bit = f * k + j;
+            message[j * words + f / 64] |= static_cast<uint64_t>((chunk[bit / 8] >> (7 - bit % 8)) & 0x1) << (f % 64);
+        }
+    }
+
+    enc.encode_sliced(g, message, bits, words);
+
+    std::fill(frames, frames + count * frame_bytes, 0);
+    for (size_t f = 0; f < count; f++)
+    {
+        uint8_t *frame = &frames[f * frame_bytes];
+        for (size_t i = 0; i < n; i++)
+        {
+            frame[i / 8] |= ((bits[i * words + f / 64] >> (f % 64)) & 0x1) << (7 - i % 8);
+        }
+    }
+
+    return count;
+}
+
+size_t comp::ldpc::encode_frames(const tanner_graph &g, const systematic_encoder &enc, std::istream &in, std::ostream &out)
+{
+    const size_t words = 4;
+    const size_t batch_frames = words * 64;
+    const size_t k = enc.k();
+    const size_t frame_bytes = (g.num_bits() + 7) / 8;
+
+    /* 256 messages of k bits are exactly 32 * k bytes: */
+    std::vector<uint8_t> chunk(batch_frames * k / 8);
+    std::vector<uint8_t> frames(batch_frames * frame_bytes);
+    std::vector<uint64_t> message, bits;
+    size_t total = 0;
+
+    while (in.read(reinterpret_cast<char *>(chunk.data()), chunk.size()) || in.gcount())
+    {
+        const size_t length = in.gcount();
+
+        std::fill(chunk.begin() + length, chunk.end(), 0);
+
+        const size_t count = encode_batch(g, enc, chunk.data(), length, words, message, bits, frames.data());
+
+        out.write(reinterpret_cast<const char *>(frames.data()), count * frame_bytes);
+        total += count;
+    }
+
+    return total;
+}
+
+size_t comp::ldpc::encode_frames(const tanner_graph &g, const systematic_encoder &enc, std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    const size_t words = 4;
+    const size_t batch_frames = words * 64;
+    const size_t k = enc.k();
+    const size_t frame_bytes = (g.num_bits() + 7) / 8;
+    const size_t chunk_bytes = batch_frames * k / 8;
+
+    out.resize((in.size() * 8 + k - 1) / k * frame_bytes);
+
+    std::vector<uint64_t> message, bits;
+    std::vector<uint8_t> last;
+    size_t total = 0;
+
+    for (size_t offset = 0; offset < in.size(); offset += chunk_bytes)
+    {
+        const size_t length = std::min(chunk_bytes, in.size() - offset);
+        const uint8_t *chunk = &in[offset];
+
+        /* Only the last chunk is short, and needs its zero padding: */
+        if (length < chunk_bytes)
+        {
+            last.assign(chunk_bytes, 0);
+            std::copy(chunk, chunk + length, last.begin());
+            chunk = last.data();
+        }
+
+        total += encode_batch(g, enc, chunk, length, words, message, bits, &out[total * frame_bytes]);
+    }
+
+    return total;
+}
+
+void comp::ldpc::bsc(std::vector<uint64_t> &bits, double p, Random &rng)
+{
+    if (p <= 0)
+    {
+        return;
+    }
+
+    /* Gaps between flipped bits are geometric, so the cost is proportional to the number of errors, not bits: */
+    const double scale = 1.0 / std::log1p(-std::min(p, 1.0 - 1e-12));
+    const size_t total = bits.size() * 64;
+
+    auto skip = [&]()
+    {
+        return static_cast<size_t>(std::log(rng.uniform()) * scale);
+    };
+
+    for (size_t k = skip(); k < total; k += 1 + skip())
+    {
+        bits[k / 64] ^= 0x1ULL << (k % 64);
+    }
+}
+
+comp::sim_point comp::ldpc::simulate(const tanner_graph &g, double p, size_t target_errors, size_t max_frames, uint64_t seed,
+                                     size_t threads, int max_iterations, uint32_t layers)
+{
+    const size_t words = 4;
+    const size_t batch_frames = words * 64;
+    const size_t n = g.num_bits();
+
+    ThreadPool pool(threads);
+
+    std::atomic<size_t> frames(0), frame_errors(0);
+    std::vector<sim_point> partial(pool.size());
+    std::vector<std::future<void>> done;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t t = 0; t < pool.size(); t++)
+    {
+        done.push_back(pool.submit([&, t]()
+                                   {
+            Random rng(seed + t);
+            std::vector<uint64_t> bits(n * words);
+            std::vector<uint8_t> iterations;
+            sim_point &local = partial[t];
+
+            while (frame_errors.load() < target_errors && frames.fetch_add(batch_frames) < max_frames)
+            {
+                std::fill(bits.begin(), bits.end(), 0);
+                bsc(bits, p, rng);
+
+                gallager_b_decode_sliced(g, bits, words, max_iterations, &iterations, layers);
+
+                /* Anything left non-zero is a residual error: */
+                std::vector<uint64_t> failed(words, 0);
+                for (size_t i = 0; i < n; i++)
+                {
+                    for (size_t w = 0; w < words; w++)
+                    {
+                        local.bit_errors += __builtin_popcountll(bits[i * words + w]);
+                        failed[w] |= bits[i * words + w];
+                    }
+                }
+
+                size_t errors = 0;
+                for (uint64_t f : failed)
+                {
+                    errors += __builtin_popcountll(f);
+                }
+
+                for (uint8_t it : iterations)
+                {
+                    local.iterations += it;
+                }
+
+                local.frames += batch_frames;
+                local.frame_errors += errors;
+                frame_errors += errors;
+            } }));
+    }
+
+    for (auto &d : done)
+    {
+        d.get();
+    }
+
+    sim_point result;
+    result.p = p;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto &local : partial)
+    {
+        result.frames += local.frames;
+        result.frame_errors += local.frame_errors;
+        result.bit_errors += local.bit_errors;
+        result.iterations += local.iterations;
+    }
+
+    return result;
+}
+
+std::pair<comp::sim_point, comp::sim_point> comp::ldpc::simulate_awgn(const tanner_graph &g, double ebn0_db, size_t target_errors, size_t max_frames,
+                                                                      uint64_t seed, size_t threads, int max_iterations, unsigned decoders)
+{
+    const size_t words = 4;
+    const size_t batch_frames = words * 64;
+    const size_t lanes = min_sum_lanes;
+    const size_t n = g.num_bits();
+
+    /* Fixed-point samples: 1.0 maps to `scale`. Normalized min-sum does not depend on the LLR scale, only on its resolution. */
+    const double scale = 16;
+    const double rate = 1.0 - static_cast<double>(g.num_checks()) / n;
+    const double sigma = std::sqrt(1.0 / (2 * rate * std::pow(10.0, ebn0_db / 10)));
+
+    ThreadPool pool(threads);
+
+    std::atomic<size_t> frames(0), min_sum_errors(0), gallager_errors(0);
+    std::vector<std::pair<sim_point, sim_point>> partial(pool.size());
+    std::vector<std::future<void>> done;
+
+    for (size_t t = 0; t < pool.size(); t++)
+    {
+        done.push_back(pool.submit([&, t]()
+                                   {
+            Random rng(seed + t);
+            std::vector<int8_t> llr(n * batch_frames);
+            std::vector<uint64_t> bits(n * words);
+            std::vector<uint8_t> hard(n * lanes), counts(batch_frames);
+            auto &[ms, gb] = partial[t];
+
+            /* Until every decoder that runs has seen `target_errors`: */
+            auto short_of_errors = [&]()
+            {
+                return ((decoders & awgn_min_sum) && min_sum_errors < target_errors) || ((decoders & awgn_gallager_b) && gallager_errors < target_errors);
+            };
+
+            while (short_of_errors() && frames.fetch_add(batch_frames) < max_frames)
+            {
+                /* All-zero codeword, BPSK (0 -> +1); llr is grouped by `lanes` frames: */
+                std::fill(bits.begin(), bits.end(), 0);
+                for (size_t f = 0; f < batch_frames; f++)
+                {
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        const double y = 1.0 + sigma * rng.normal();
+
+                        llr[(f / lanes) * n * lanes + i * lanes + f % lanes] = static_cast<int8_t>(std::clamp(std::lround(y * scale), -127L, 127L));
+                        bits[i * words + f / 64] |= static_cast<uint64_t>(y < 0) << (f % 64);
+                    }
+                }
+
+                if (decoders & awgn_min_sum)
+                {
+                    auto start = std::chrono::steady_clock::now();
+
+                    for (size_t group = 0; group < batch_frames / lanes; group++)
+                    {
+                        min_sum_decode_batch(g, &llr[group * n * lanes], hard.data(), max_iterations, &counts[group * lanes]);
+
+                        uint32_t failed = 0;
+                        for (size_t i = 0; i < n * lanes; i++)
+                        {
+                            ms.bit_errors += hard[i];
+                            failed |= static_cast<uint32_t>(hard[i]) << (i % lanes);
+                        }
+
+                        ms.frame_errors += __builtin_popcount(failed);
+                        min_sum_errors += __builtin_popcount(failed);
+                    }
+
+                    ms.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    for (uint8_t it : counts)
+                    {
+                        ms.iterations += it;
+                    }
+                    ms.frames += batch_frames;
+                }
+
+                if (!(decoders & awgn_gallager_b))
+                {
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+
+                gallager_b_decode_sliced(g, bits, words, max_iterations, &counts);
+
+                gb.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                std::vector<uint64_t> failed(words, 0);
+                for (size_t i = 0; i < n; i++)
+                {
+                    for (size_t w = 0; w < words; w++)
+                    {
+                        gb.bit_errors += __builtin_popcountll(bits[i * words + w]);
+                        failed[w] |= bits[i * words + w];
+                    }
+                }
+
+                for (uint64_t f : failed)
+                {
+                    gb.frame_errors += __builtin_popcountll(f);
+                    gallager_errors += __builtin_popcountll(f);
+                }
+
+                for (uint8_t it : counts)
+                {
+                    gb.iterations += it;
+                }
+                gb.frames += batch_frames;
+            } }));
+    }
+
+    for (auto &d : done)
+    {
+        d.get();
+    }
+
+    std::pair<sim_point, sim_point> result;
+    result.first.p = result.second.p = ebn0_db;
+
+    for (auto &[ms, gb] : partial)
+    {
+        for (auto [total, local] : {std::make_pair(&result.first, &ms), std::make_pair(&result.second, &gb)})
+        {
+            total->frames += local->frames;
+            total->frame_errors += local->frame_errors;
+            total->bit_errors += local->bit_errors;
+            total->iterations += local->iterations;
+            total->seconds += local->seconds;
+        }
+    }
+
+    return result;
+}
+
+comp::sim_point comp::ldpc::simulate_bec(const tanner_graph &g, const systematic_encoder &enc, double p, size_t symbol_size, size_t target_errors,
+                                         size_t max_frames, uint64_t seed, size_t threads)
+{
+    const size_t words = (symbol_size + 7) / 8;
+    const size_t n = g.num_bits();
+
+    ThreadPool pool(threads);
+
+    std::atomic<size_t> frames(0), errors(0);
+    std::vector<sim_point> partial(pool.size());
+    std::vector<std::future<void>> done;
+
+    for (size_t t = 0; t < pool.size(); t++)
+    {
+        done.push_back(pool.submit([&, t]()
+                                   {
+            Random rng(seed + t);
+            sim_point &local = partial[t];
+
+            /* One random codeword per thread, erased differently every frame: */
+            std::vector<uint64_t> message(enc.k() * words), sent, received(n * words);
+            for (auto &w : message)
+            {
+                w = rng.next();
+            }
+            enc.encode_sliced(g, message, sent, words);
+
+            std::vector<uint8_t> erased(n);
+
+            while (errors.load() < target_errors && frames.fetch_add(1) < max_frames)
+            {
+                received = sent;
+                for (size_t v = 0; v < n; v++)
+                {
+                    erased[v] = rng.uniform() <= p;
+                    if (erased[v])
+                    {
+                        std::fill(&received[v * words], &received[(v + 1) * words], 0);
+                    }
+                }
+
+                auto start = std::chrono::steady_clock::now();
+
+                bool eliminated;
+                erasure_decode(g, reinterpret_cast<uint8_t *>(received.data()), words * 8, erased, &eliminated);
+
+                local.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                local.eliminations += eliminated;
+                local.frames++;
+
+                /* Anything recovered wrong counts as lost: */
+                size_t lost = 0;
+                for (size_t v = 0; v < n; v++)
+                {
+                    lost += erased[v] || !std::equal(&received[v * words], &received[(v + 1) * words], &sent[v * words]);
+                }
+
+                if (lost)
+                {
+                    local.bit_errors += lost;
+                    local.frame_errors++;
+                    errors++;
+                }
+            } }));
+    }
+
+    for (auto &d : done)
+    {
+        d.get();
+    }
+
+    sim_point result;
+    result.p = p;
+
+    for (auto &local : partial)
+    {
+        result.frames += local.frames;
+        result.frame_errors += local.frame_errors;
+        result.bit_errors += local.bit_errors;
+        result.eliminations += local.eliminations;
+        result.seconds += local.seconds;
+    }
+
+    return result;
+}
+
+comp::sim_point comp::ldpc::simulate_awgn(const qc_code &qc, double ebn0_db, size_t target_errors, size_t max_frames,
+                                          uint64_t seed, size_t threads, int max_iterations)
+{
+    const size_t n = qc.num_bits();
+
+    /* Same channel, and the same quantization, as the edge-level decoders above: */
+    const double scale = 16;
+    const double rate = 1.0 - static_cast<double>(qc.num_checks()) / n;
+    const double sigma = std::sqrt(1.0 / (2 * rate * std::pow(10.0, ebn0_db / 10)));
+
+    ThreadPool pool(threads);
+
+    std::atomic<size_t> frames(0), errors(0);
+    std::vector<sim_point> partial(pool.size());
+    std::vector<std::future<void>> done;
+
+    for (size_t t = 0; t < pool.size(); t++)
+    {
+        done.push_back(pool.submit([&, t]()
+                                   {
+            Random rng(seed + t);
+            std::vector<int8_t> llr(n);
+            sim_point &local = partial[t];
+
+            while (errors.load() < target_errors && frames.fetch_add(1) < max_frames)
+            {
+                for (auto &x : llr)
+                {
+                    const double y = 1.0 + sigma * rng.normal();
+                    x = static_cast<int8_t>(std::clamp(std::lround(y * scale), -127L, 127L));
+                }
+
+                auto start = std::chrono::steady_clock::now();
+
+                int iterations;
+                const std::vector<int> decoded = min_sum_decode(qc, llr, max_iterations, &iterations);
+
+                local.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                local.iterations += iterations;
+                local.frames++;
+
+                const size_t wrong = std::count(decoded.begin(), decoded.end(), 1);
+                if (wrong)
+                {
+                    local.bit_errors += wrong;
+                    local.frame_errors++;
+                    errors++;
+                }
+            } }));
+    }
+
+    for (auto &d : done)
+    {
+        d.get();
+    }
+
+    sim_point result;
+    result.p = ebn0_db;
+
+    for (auto &local : partial)
+    {
+        result.frames += local.frames;
+        result.frame_errors += local.frame_errors;
+        result.bit_errors += local.bit_errors;
+        result.iterations += local.iterations;
+        result.seconds += local.seconds;
+    }
+
+    return result;
+}
+
+void comp::systematic_encoder::build(const tanner_graph &g)
+{
+    const uint32_t n = g.num_bits();
+    const uint32_t m = g.num_checks();
+
+    /*
+     * Greedy triangulation (Richardson & Urbanke). While some check has a single unknown bit left,
+     * that bit is resolved by the check (back-substitution at encoding time). Otherwise, one bit of the check
+     * with the fewest unknowns is declared known. Known bits become message bits, except for a few (the gap)
+     * that are needed to satisfy the checks never used for resolving; those are solved densely below.
+     */
+    enum : uint8_t
+    {
+        unknown = 0,
+        known = 1,
+        resolved = 2
+    };
+
+    std::vector<uint8_t> state(n, unknown);
+    std::vector<uint8_t> used(m, 0);
+    std::vector<uint32_t> unknowns(m);
+    std::vector<std::vector<uint32_t>> bucket;
+    std::vector<uint32_t> known_bits;
+
+    for (uint32_t c = 0; c < m; c++)
+    {
+        unknowns[c] = g.check_ptr[c + 1] - g.check_ptr[c];
+        if (bucket.size() <= unknowns[c])
+        {
+            bucket.resize(unknowns[c] + 1);
+        }
+        bucket[unknowns[c]].push_back(c);
+    }
+
+    /* Checks are bucketed by their number of unknowns; stale entries are skipped when popped: */
+    size_t lowest = 1;
+
+    auto settle = [&](uint32_t v)
+    {
+        for (uint32_t i = g.var_ptr[v]; i < g.var_ptr[v + 1]; i++)
+        {
+            const uint32_t c = g.edge_check[g.var_edge[i]];
+
+            bucket[--unknowns[c]].push_back(c);
+            lowest = std::min<size_t>(lowest, std::max<uint32_t>(unknowns[c], 1));
+        }
+    };
+
+    schedule.clear();
+
+    for (;;)
+    {
+        uint32_t c = m;
+
+        for (; lowest < bucket.size() && c == m; lowest += (c == m))
+        {
+            while (!bucket[lowest].empty() && c == m)
+            {
+                const uint32_t candidate = bucket[lowest].back();
+                bucket[lowest].pop_back();
+
+                if (!used[candidate] && unknowns[candidate] == lowest)
+                {
+                    c = candidate;
+                }
+            }
+        }
+
+        if (c == m)
+        {
+            break;
+        }
+
+        uint32_t v = n;
+        for (uint32_t e = g.check_ptr[c]; e < g.check_ptr[c + 1] && v == n; e++)
+        {
+            if (state[g.edge_var[e]] == unknown)
+            {
+                v = g.edge_var[e];
+            }
+        }
+
+        if (unknowns[c] == 1)
+        {
+            used[c] = 1;
+            state[v] = resolved;
+            schedule.emplace_back(c, v);
+        }
+        else
+        {
+            state[v] = known;
+            known_bits.push_back(v);
+        }
+
+        settle(v);
+    }
+
+    /* Bits without any check: */
+    for (uint32_t v = 0; v < n; v++)
+    {
+        if (state[v] == unknown)
+        {
+            known_bits.push_back(v);
+        }
+    }
+
+    std::vector<uint32_t> leftover;
+    for (uint32_t c = 0; c < m; c++)
+    {
+        if (!used[c])
+        {
+            leftover.push_back(c);
+        }
+    }
+
+    /* Express every leftover check over the known bits, 64 known bits at a time (bit-sliced back-substitution): */
+    const size_t known_count = known_bits.size();
+    const size_t known_words = (known_count + 63) / 64;
+
+    std::vector<uint64_t> rows(leftover.size() * known_words, 0);
+    std::vector<uint64_t> value(n);
+
+    for (size_t first = 0; first < known_count; first += 64)
+    {
+        std::fill(value.begin(), value.end(), 0);
+        for (size_t j = first; j < known_count && j < first + 64; j++)
+        {
+            value[known_bits[j]] = 0x1ULL << (j - first);
+        }
+
+        for (auto &[check, v] : schedule)
+        {
+            uint64_t x = 0;
+            for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+            {
+                x ^= value[g.edge_var[e]];
+            }
+            value[v] = x;
+        }
+
+        for (size_t i = 0; i < leftover.size(); i++)
+        {
+            uint64_t x = 0;
+            for (uint32_t e = g.check_ptr[leftover[i]]; e < g.check_ptr[leftover[i] + 1]; e++)
+            {
+                x ^= value[g.edge_var[e]];
+            }
+            rows[i * known_words + first / 64] = x;
+        }
+    }
+
+    /* Reduced row echelon form; pivot columns are the gap bits, the rest carry the message: */
+    std::vector<uint8_t> is_pivot(known_count, 0);
+    std::vector<size_t> pivots;
+    size_t rank = 0;
+
+    for (size_t col = 0; col < known_count && rank < leftover.size(); col++)
+    {
+        const size_t word = col / 64;
+        const uint64_t mask = 0x1ULL << (col % 64);
+
+        size_t r = rank;
+        while (r < leftover.size() && !(rows[r * known_words + word] & mask))
+        {
+            r++;
+        }
+
+        if (r == leftover.size())
+        {
+            continue;
+        }
+
+        std::swap_ranges(&rows[r * known_words], &rows[(r + 1) * known_words], &rows[rank * known_words]);
+
+        for (size_t i = 0; i < leftover.size(); i++)
+        {
+            if (i != rank && (rows[i * known_words + word] & mask))
+            {
+                for (size_t w = word; w < known_words; w++)
+                {
+                    rows[i * known_words + w] ^= rows[rank * known_words + w];
+                }
+            }
+        }
+
+        is_pivot[col] = 1;
+        pivots.push_back(col);
+        rank++;
+    }
+
+    info.clear();
+    gap.clear();
+
+    std::vector<uint32_t> message_index(known_count);
+    for (size_t col = 0; col < known_count; col++)
+    {
+        if (is_pivot[col])
+        {
+            gap.push_back(known_bits[col]);
+        }
+        else
+        {
+            message_index[col] = info.size();
+            info.push_back(known_bits[col]);
+        }
+    }
+
+    /* gap bit i = XOR of the message bits set in its row: */
+    row_words = (info.size() + 63) / 64;
+    gap_rows.assign(rank * row_words, 0);
+
+    for (size_t i = 0; i < rank; i++)
+    {
+        for (size_t col = 0; col < known_count; col++)
+        {
+            if (!is_pivot[col] && (rows[i * known_words + col / 64] >> (col % 64)) & 0x1)
+            {
+                const uint32_t j = message_index[col];
+                gap_rows[i * row_words + j / 64] |= 0x1ULL << (j % 64);
+            }
+        }
+    }
+}
+
+void comp::systematic_encoder::encode(const tanner_graph &g, const uint8_t *message, uint8_t *frame) const
+{
+    const size_t n = g.num_bits();
+
+    std::vector<uint8_t> x(n, 0);
+    std::vector<uint64_t> packed(row_words, 0);
+
+    for (size_t j = 0; j < info.size(); j++)
+    {
+        const uint8_t bit = (message[j / 8] >> (7 - j % 8)) & 0x1;
+
+        x[info[j]] = bit;
+        packed[j / 64] |= static_cast<uint64_t>(bit) << (j % 64);
+    }
+
+    for (size_t i = 0; i < gap.size(); i++)
+    {
+        const uint64_t *row = &gap_rows[i * row_words];
+        uint64_t parity = 0;
+
+        for (size_t w = 0; w < row_words; w++)
+        {
+            parity ^= row[w] & packed[w];
+        }
+        x[gap[i]] = __builtin_parityll(parity);
+    }
+
+    /* Back-substitution; the resolved bit itself is still 0, so it can be included in the XOR: */
+    for (auto &[check, v] : schedule)
+    {
+        uint8_t bit = 0;
+        for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+        {
+            bit ^= x[g.edge_var[e]];
+        }
+        x[v] = bit;
+    }
+
+    std::fill(frame, frame + (n + 7) / 8, 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        frame[i / 8] |= x[i] << (7 - i % 8);
+    }
+}
+
+void comp::systematic_encoder::encode_sliced(const tanner_graph &g, const std::vector<uint64_t> &message, std::vector<uint64_t> &bits, size_t words) const
+{
+    bits.assign(g.num_bits() * words, 0);
+
+    for (size_t j = 0; j < info.size(); j++)
+    {
+        std::copy(&message[j * words], &message[(j + 1) * words], &bits[info[j] * words]);
+    }
+
+    for (size_t i = 0; i < gap.size(); i++)
+    {
+        uint64_t *b = &bits[gap[i] * words];
+
+        for (size_t w = 0; w < row_words; w++)
+        {
+            for (uint64_t set = gap_rows[i * row_words + w]; set; set &= set - 1)
+            {
+                const uint64_t *source = &message[(w * 64 + __builtin_ctzll(set)) * words];
+                for (size_t f = 0; f < words; f++)
+                {
+                    b[f] ^= source[f];
+                }
+            }
+        }
+    }
+
+    for (auto &[check, v] : schedule)
+    {
+        uint64_t *b = &bits[v * words];
+
+        for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+        {
+            if (g.edge_var[e] == v)
+            {
+                continue;
+            }
+
+            const uint64_t *source = &bits[g.edge_var[e] * words];
+            for (size_t f = 0; f < words; f++)
+            {
+                b[f] ^= source[f];
+            }
+        }
+    }
+}
+
+void comp::systematic_encoder::extract(const uint8_t *frame, uint8_t *message) const
+{
+    std::fill(message, message + (info.size() + 7) / 8, 0);
+
+    for (size_t j = 0; j < info.size(); j++)
+    {
+        const uint8_t bit = (frame[info[j] / 8] >> (7 - info[j] % 8)) & 0x1;
+        message[j / 8] |= bit << (7 - j % 8);
+    }
+}
+
+/* CRC32C of H, row by row, which the cached encoder must have been built from: */
+static uint32_t graph_hash(const comp::tanner_graph &g)
+{
+    auto bytes = [](const std::vector<uint32_t> &v)
+    {
+        return std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(v.data()), v.size() * sizeof(uint32_t));
+    };
+
+    return comp::checksum::crc32c(bytes(g.edge_var), comp::checksum::crc32c(bytes(g.check_ptr)));
+}
+
+/*
+ * Serialized encoder:
+ * 1. { magic | version | n | k | gap bit count | schedule length | hash of H }, 32-bit little endian
+ * 2. { check | variable }, for every schedule entry
+ * 3. { info positions } { gap positions }
+ * 4. { gap rows }, 64-bit little endian words
+ */
+bool comp::systematic_encoder::save(const std::string &filename, const tanner_graph &g) const
+{
+    std::vector<char> buf;
+
+    auto put = [&buf](uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            buf.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    };
+
+    buf.insert(buf.end(), std::begin(encoder_magic), std::end(encoder_magic));
+    buf.push_back(encoder_version);
+    put(info.size() + gap.size() + schedule.size(), 4);
+    put(info.size(), 4);
+    put(gap.size(), 4);
+    put(schedule.size(), 4);
+    put(graph_hash(g), 4);
+
+    for (auto &[check, v] : schedule)
+    {
+        put(check, 4);
+        put(v, 4);
+    }
+    for (uint32_t v : info)
+    {
+        put(v, 4);
+    }
+    for (uint32_t v : gap)
+    {
+        put(v, 4);
+    }
+    for (uint64_t word : gap_rows)
+    {
+        put(word, 8);
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    out.write(buf.data(), buf.size());
+
+    return static_cast<bool>(out);
+}
+
+bool comp::systematic_encoder::load(const std::string &filename, const tanner_graph &g)
+{
+    std::ifstream in(filename, std::ios::binary);
+
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+
+    auto get = [&buf, &pos](int bytes, uint64_t &value)
+    {
+        if (pos + bytes > buf.size())
+        {
+            return false;
+        }
+
+        value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint64_t>(buf[pos++]) << (8 * i);
+        }
+        return true;
+    };
+
+    uint64_t magic, version, n, k, gap_count, steps, hash;
+
+    /* Sizes alone match any code of the same length and rank; the hash ties the encoder to this H: */
+    if (!get(4, magic) || !std::equal(std::begin(encoder_magic), std::end(encoder_magic), buf.begin()) ||
+        !get(1, version) || version != encoder_version ||
+        !get(4, n) || n != g.num_bits() ||
+        !get(4, k) || !get(4, gap_count) || !get(4, steps) || k + gap_count + steps != n ||
+        !get(4, hash) || hash != graph_hash(g))
+    {
+        return false;
+    }
+
+    auto get_index = [&](uint32_t &value, uint64_t limit)
+    {
+        uint64_t t;
+        if (!get(4, t) || t >= limit)
+        {
+            return false;
+        }
+        value = t;
+        return true;
+    };
+
+    schedule.resize(steps);
+    for (auto &[check, v] : schedule)
+    {
+        if (!get_index(check, g.num_checks()) || !get_index(v, n))
+        {
+            return false;
+        }
+    }
+
+    info.resize(k);
+    for (auto &v : info)
+    {
+        if (!get_index(v, n))
+        {
+            return false;
+        }
+    }
+
+    gap.resize(gap_count);
+    for (auto &v : gap)
+    {
+        if (!get_index(v, n))
+        {
+            return false;
+        }
+    }
+
+    row_words = (k + 63) / 64;
+    gap_rows.resize(gap_count * row_words);
+    for (auto &word : gap_rows)
+    {
+        if (!get(8, word))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
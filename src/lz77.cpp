@@ -0,0 +1,414 @@
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <algorithm>
+
+#include "lz77.hpp"
+#include "stats.hpp"
+#include "estimate.hpp"
+
+const std::string comp::lz77::ext = ".lz77";
+
+/* {start_position, len, byte} */
+struct token
+{
+    uint8_t bytes[3];
+};
+
+/* Kept whether or not anyone asks, a few additions per token; reported once at the end: */
+struct token_counts
+{
+    size_t literals = 0, matches = 0, match_bytes = 0, probes = 0, stored_blocks = 0;
+
+    void add(const token &t, size_t searched)
+    {
+        (t.bytes[1] ? matches : literals)++;
+        match_bytes += t.bytes[1];
+        probes += searched;
+    }
+
+    void add(const token_counts &other)
+    {
+        literals += other.literals;
+        matches += other.matches;
+        match_bytes += other.match_bytes;
+    }
+
+    void report(comp::stats *s, size_t input) const
+    {
+        if (!s)
+        {
+            return;
+        }
+
+        s->set("input_bytes", input);
+        s->set("literals", literals);
+        s->set("matches", matches);
+        s->set("literal_match_ratio", matches ? static_cast<double>(literals) / matches : 0);
+        s->set("average_match_length", matches ? static_cast<double>(match_bytes) / matches : 0);
+        s->set("probes_per_byte", input ? static_cast<double>(probes) / input : 0);
+        s->set("stored_blocks", stored_blocks);
+    }
+};
+
+/* `search` ends where `lookahead` starts, both inside the same input, so a match may run on into the lookahead buffer. */
+static token largest_repeating_sequence(std::span<const uint8_t> search, std::span<const uint8_t> lookahead)
+{
+    /* Longest match first; among equally long ones, the one starting closest to the lookahead buffer.
+     * The last lookahead byte is never part of a match, it is needed as the next byte of the token.
+     */
+    size_t best_length = 0, best_start = 0;
+
+    for (size_t i = search.size(); i-- > 0;)
+    {
+        const uint8_t *from = search.data() + i;
+        size_t length = 0;
+
+        while (length < lookahead.size() - 1 && from[length] == lookahead[length])
+        {
+            length++;
+        }
+
+        if (length > best_length)
+        {
+            best_length = length;
+            best_start = i;
+        }
+    }
+
+    /* Otherwise, a unique byte has been encountered, add it to the search buffer.
+     *
+     * Additionally, this case is triggered if all bytes in the lookahead buffer form
+     * a substring somewhere in the search buffer. Example:
+     *
+     *       SEARCH[n+1]         LOOKAHEAD[3]
+     *
+     * a0, a1, a2, a3, ..., an | a1, a2, a3
+     *
+     * a1, a2 will be caught above, whereas a3 will be re-added to the search buffer as if was distinct,
+     * regardless if it already exists in the search buffer. This does weaken the compression ratio, but only by a negligible amount.
+     */
+    return {.bytes = {static_cast<uint8_t>(best_start), static_cast<uint8_t>(best_length), lookahead[best_length]}};
+}
+
+/* Codes one block, data[start, end), with matches searched back into data before `start` too. Counts go to `counts`. */
+static void encode_block(std::span<const uint8_t> data, size_t start, std::vector<uint8_t> &out, token_counts &counts)
+{
+    const std::span<const uint8_t> block = data.subspan(start);
+    const size_t mark = out.size();
+
+    if (!comp::estimate::incompressible(block))
+    {
+        token_counts block_counts;
+
+        for (size_t pos = start; pos < data.size();)
+        {
+            const size_t search_start = (pos > comp::lz77::search_buffer_size) ? pos - comp::lz77::search_buffer_size : 0;
+            const size_t lookahead_end = std::min<size_t>(pos + comp::lz77::lookahead_buffer_size, data.size());
+
+            const token result = largest_repeating_sequence(data.subspan(search_start, pos - search_start),
+                                                            data.subspan(pos, lookahead_end - pos));
+
+            out.insert(out.end(), result.bytes, result.bytes + sizeof(result.bytes));
+            block_counts.add(result, pos - search_start);
+            pos += result.bytes[1] + 1;
+        }
+
+        counts.probes += block_counts.probes;
+
+        /* The sample can be wrong; what the tokens cost is known now: */
+        if (out.size() - mark < block.size() + sizeof(token))
+        {
+            counts.add(block_counts);
+            return;
+        }
+        out.resize(mark);
+    }
+
+    const size_t last = block.size() - 1;
+
+    out.push_back(comp::lz77::stored);
+    out.push_back(static_cast<uint8_t>(last >> 8));
+    out.push_back(static_cast<uint8_t>(last));
+    out.insert(out.end(), block.begin(), block.end());
+    counts.stored_blocks++;
+}
+
+void comp::lz77::encode(std::span<const uint8_t> in, std::vector<uint8_t> &out, stats *s)
+{
+    token_counts counts;
+
+    out.clear();
+    out.push_back(search_buffer_size);
+    out.push_back(lookahead_buffer_size);
+
+    for (size_t start = 0; start < in.size(); start += block_size)
+    {
+        const size_t from = (start > search_buffer_size) ? start - search_buffer_size : 0;
+        const size_t end = std::min(start + block_size, in.size());
+
+        encode_block(in.subspan(from, end - from), start - from, out, counts);
+    }
+
+    counts.report(s, in.size());
+}
+
+bool comp::lz77::decode(std::span<const uint8_t> in, std::vector<uint8_t> &decoded)
+{
+    decoded.clear();
+
+    if (in.size() < 2)
+    {
+        return false;
+    }
+
+    const uint8_t search_size = in[0];
+
+    for (size_t pos = 2; pos < in.size(); pos += sizeof(token))
+    {
+        if (in.size() - pos < sizeof(token))
+        {
+            return false;
+        }
+
+        const token t = {.bytes = {in[pos], in[pos + 1], in[pos + 2]}};
+
+        if (t.bytes[0] == stored)
+        {
+            const size_t size = ((t.bytes[1] << 8) | t.bytes[2]) + 1;
+
+            if (in.size() - pos - sizeof(token) < size)
+            {
+                return false;
+            }
+
+            decoded.insert(decoded.end(), in.begin() + pos + sizeof(token), in.begin() + pos + sizeof(token) + size);
+            pos += size;
+            continue;
+        }
+
+        if (t.bytes[1])
+        {
+            const size_t index_shift = (decoded.size() > search_size) ? decoded.size() - search_size : 0;
+
+            /* The match may overlap the bytes it produces, but has to start with one that is already there: */
+            if (t.bytes[0] >= search_size || index_shift + t.bytes[0] >= decoded.size())
+            {
+                return false;
+            }
+
+            for (size_t i = t.bytes[0]; i < t.bytes[0] + t.bytes[1]; i++)
+            {
+                decoded.push_back(decoded[index_shift + i]);
+            }
+        }
+        decoded.push_back(t.bytes[2]);
+    }
+
+    return true;
+}
+
+/* Input is gathered a block at a time, behind the search buffer of the block before: [ search buffer | block ].
+ * Blocks fall where they do in encode(), so the output is the same.
+ */
+class lz77_encoder : public comp::stream_coder
+{
+public:
+    lz77_encoder(comp::stats *s) : stats(s)
+    {
+        window.reserve(comp::lz77::search_buffer_size + comp::lz77::block_size);
+
+        output.push_back(comp::lz77::search_buffer_size);
+        output.push_back(comp::lz77::lookahead_buffer_size);
+    }
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        for (consumed = 0;;)
+        {
+            if (window.size() == search + comp::lz77::block_size)
+            {
+                if (full())
+                {
+                    return output_full;
+                }
+                encode();
+            }
+
+            if (consumed == in.size())
+            {
+                return need_input;
+            }
+
+            const size_t n = std::min(in.size() - consumed, search + comp::lz77::block_size - window.size());
+            window.insert(window.end(), in.begin() + consumed, in.begin() + consumed + n);
+
+            consumed += n;
+            total += n;
+        }
+    }
+
+    status finish() override
+    {
+        if (!finished)
+        {
+            if (window.size() > search)
+            {
+                encode();
+            }
+
+            counts.report(stats, total);
+            finished = true;
+        }
+
+        return pending_or(done);
+    }
+
+private:
+    std::vector<uint8_t> window;
+
+    /* Bytes of the previous block at the front of the window: */
+    size_t search = 0;
+
+    comp::stats *stats;
+    token_counts counts;
+    size_t total = 0;
+
+    void encode()
+    {
+        encode_block(window, search, output, counts);
+
+        search = std::min<size_t>(window.size(), comp::lz77::search_buffer_size);
+        window.erase(window.begin(), window.end() - search);
+    }
+};
+
+class lz77_decoder : public comp::stream_coder
+{
+public:
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        for (consumed = 0; consumed < in.size() && !failed;)
+        {
+            if (full())
+            {
+                return output_full;
+            }
+
+            /* Header (search buffer size, lookahead buffer size), then tokens and stored blocks, any of it split between fragments: */
+            if (header_size < 2)
+            {
+                if (header_size++ == 0)
+                {
+                    search_size = in[consumed];
+                }
+                consumed++;
+                continue;
+            }
+
+            if (stored_left)
+            {
+                const size_t n = std::min(stored_left, in.size() - consumed);
+
+                append(in.subspan(consumed, n));
+                stored_left -= n;
+                consumed += n;
+                continue;
+            }
+
+            t.bytes[token_size++] = in[consumed++];
+            if (token_size == sizeof(t.bytes))
+            {
+                decode_token();
+                token_size = 0;
+            }
+        }
+
+        return failed ? corrupt : need_input;
+    }
+
+    status finish() override
+    {
+        failed = failed || header_size < 2 || token_size != 0 || stored_left != 0;
+        finished = true;
+
+        return pending_or(done);
+    }
+
+private:
+    size_t header_size = 0;
+    uint8_t search_size = 0;
+
+    token t;
+    size_t token_size = 0;
+
+    /* Bytes of a stored block still to come: */
+    size_t stored_left = 0;
+
+    /* The last `search_size` decoded bytes at least, and `total` decoded in all: */
+    std::vector<uint8_t> history;
+    size_t total = 0;
+
+    void decode_token()
+    {
+        const size_t history_start = total - history.size();
+
+        if (t.bytes[0] == comp::lz77::stored)
+        {
+            stored_left = ((t.bytes[1] << 8) | t.bytes[2]) + 1;
+            return;
+        }
+
+        if (t.bytes[1])
+        {
+            const size_t index_shift = (total > search_size) ? total - search_size : 0;
+
+            /* The match may overlap the bytes it produces, but has to start with one that is already there: */
+            if (t.bytes[0] >= search_size || index_shift + t.bytes[0] >= total)
+            {
+                failed = true;
+                return;
+            }
+
+            for (size_t i = t.bytes[0]; i < t.bytes[0] + t.bytes[1]; i++)
+            {
+                history.push_back(history[index_shift + i - history_start]);
+            }
+        }
+        history.push_back(t.bytes[2]);
+
+        const size_t produced = t.bytes[1] + 1;
+        output.insert(output.end(), history.end() - produced, history.end());
+        total += produced;
+
+        trim();
+    }
+
+    void append(std::span<const uint8_t> raw)
+    {
+        output.insert(output.end(), raw.begin(), raw.end());
+        history.insert(history.end(), raw.begin(), raw.end());
+        total += raw.size();
+
+        trim();
+    }
+
+    /* Now and then, rather than every token: */
+    void trim()
+    {
+        if (history.size() >= 16 * static_cast<size_t>(search_size) + 256)
+        {
+            history.erase(history.begin(), history.end() - search_size);
+        }
+    }
+};
+
+std::unique_ptr<comp::stream_coder> comp::lz77::encoder(stats *s)
+{
+    return std::make_unique<lz77_encoder>(s);
+}
+
+std::unique_ptr<comp::stream_coder> comp::lz77::decoder()
+{
+    return std::make_unique<lz77_decoder>();
+}
@@ -0,0 +1,681 @@
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <limits>
+#include <algorithm>
+#include <map>
+
+#include "lzw.hpp"
+#include "stream.hpp"
+#include "estimate.hpp"
+#include "file_io.hpp"
+#include "common.hpp"
+
+const std::string comp::lzw::ext = ".lzw";
+
+/* Prefix tree (dictionary): */
+struct node
+{
+    static const size_t maxbytes = 256;
+
+    size_t count;
+    std::map<uint8_t, std::pair<struct node *, size_t>> bytes;
+
+    node() : count(0) {}
+
+    ~node()
+    {
+        for (auto &[byte, pair] : bytes)
+        {
+            if (pair.first)
+            {
+                delete pair.first;
+            }
+        }
+    }
+
+    /* Set `this->bytes[byte]`flag to `i`: */
+    bool insert(uint8_t byte, size_t i)
+    {
+        if (bytes.find(byte) == bytes.end())
+        {
+            count++;
+            bytes[byte] = std::make_pair(nullptr, i);
+            return true;
+        }
+        return false;
+    }
+};
+
+class Dictionary
+{
+public:
+    struct node *root;
+
+    /* Iterators: */
+    struct node *previous, *current;
+
+    /* `previous->bytes[idx] == current` */
+    uint8_t idx;
+
+    /* Dictionary size:
+     * https://jrsoftware.org/ishelp/index.php?topic=setup_lzmadictionarysize
+     */
+    /* 0xFFFFF max recommended, consumes 2GB RAM (stale info, test again) */
+    const size_t maxsize = 0xFFFF;
+    size_t count;
+
+    Dictionary()
+    {
+        root = new struct node();
+        reset();
+
+        count = 0;
+
+        /* Populate the dictionary with bytes 0, ..., 255 ahead of time: */
+        for (size_t byte = 0; byte < node::maxbytes; byte++)
+        {
+            root->insert(byte, ++count);
+        }
+    }
+
+    void reset()
+    {
+        idx = std::numeric_limits<unsigned int>::infinity();
+        previous = current = root;
+    }
+
+    /* Drop every entry except the single bytes. Only valid right after extend() has emitted a code:
+     * the current match is then a single byte, which survives the reset. */
+    void clear()
+    {
+        for (auto &[byte, pair] : root->bytes)
+        {
+            delete pair.first;
+            pair.first = nullptr;
+        }
+
+        count = node::maxbytes;
+        current = nullptr;
+    }
+
+    /* Standard LZW step.
+     *
+     * Extends the current match by `byte` if the resulting word is already in the dictionary.
+     * Otherwise, the index of the current match is written to `code`, the new word is added (as long
+     * as there is space left) and matching restarts from `byte` alone.
+     *
+     * The root holds every single byte, so a match is never empty after the first call;
+     * `previous->bytes[idx]` is always the dictionary entry of the current match.
+     */
+    bool extend(uint8_t byte, size_t &code)
+    {
+        if (current && current->bytes.find(byte) != current->bytes.end())
+        {
+            previous = current;
+            idx = byte;
+            current = current->bytes[byte].first;
+            return true;
+        }
+
+        code = previous->bytes[idx].second;
+
+        if (count < maxsize)
+        {
+            if (current == nullptr)
+            {
+                previous->bytes[idx].first = current = new struct node();
+            }
+            current->insert(byte, ++count);
+        }
+
+        previous = root;
+        idx = byte;
+        current = root->bytes[byte].first;
+        return false;
+    }
+
+    ~Dictionary()
+    {
+        delete root;
+    }
+};
+
+/* Implicit-dictionary format header: magic, format version, (maximum) word width.
+ *
+ * Version 2 writes every code at the fixed word width.
+ * Version 3 starts at `lzw_min_width` bits and widens codes as the dictionary fills up; code `lzw_clear` resets the dictionary.
+ * Version 4 adds stored blocks: two `lzw_clear` codes in a row, the block size - 1 in 16 bits, padding up to a whole byte,
+ * then the block as is. The dictionary is empty after it.
+ */
+const char lzw_magic[] = {'L', 'Z', 'W'};
+const uint8_t lzw_version_fixed = 2;
+const uint8_t lzw_version_cleared = 3;
+const uint8_t lzw_version = 4;
+
+/* Input is checked, and stored if incompressible, in blocks of this size (at most 1 << 16). Kept small so that
+ * incompressible data running into compressible data costs at most one coded block: */
+const size_t lzw_block_size = 1 << 14;
+
+const size_t lzw_clear = 0;
+const uint8_t lzw_min_width = 9;
+
+/* Number of bits needed to write any index up to `count`: */
+inline uint8_t code_width(size_t count)
+{
+    uint8_t width = 0;
+
+    while (count)
+    {
+        width++;
+        count >>= 1;
+    }
+
+    return std::max(width, lzw_min_width);
+}
+
+/* Decides when to reset the dictionary. Same idea as compress(1): check the compression ratio
+ * every `window` input bytes, and once the dictionary stops growing, start over as soon as it gets
+ * noticeably worse than the best ratio seen since the dictionary filled up. A window that is poor
+ * outright resets it whether full or not: its entries come from data unlike what follows, and
+ * only widen the codes for it.
+ */
+struct ratio_monitor
+{
+    static const size_t window = 1 << 14;
+    static constexpr double tolerance = 1.1;
+
+    /* Output bits per input bit: */
+    static constexpr double poor = 1.0;
+
+    size_t in_bytes = 0;
+    size_t out_bits = 0;
+    double best = std::numeric_limits<double>::infinity();
+
+    bool check(bool full)
+    {
+        if (in_bytes < window)
+        {
+            return false;
+        }
+
+        const double ratio = static_cast<double>(out_bits) / (8 * in_bytes);
+        in_bytes = out_bits = 0;
+
+        if (ratio >= poor || (full && ratio > best * tolerance))
+        {
+            best = std::numeric_limits<double>::infinity();
+            return true;
+        }
+
+        best = full ? std::min(best, ratio) : std::numeric_limits<double>::infinity();
+        return false;
+    }
+};
+
+/* Resumable encoder for the implicit-dictionary format. Input is gathered a block at a time, then either coded or stored;
+ * peak memory is the dictionary, a block and the pending output.
+ */
+class lzw_encoder : public comp::stream_coder
+{
+public:
+    /* Filled in by finish(), if given: */
+    lzw_encoder(comp::lzw_stats *s = nullptr) : stats(s), word_width(code_width(dict.maxsize))
+    {
+        /* Everything the decoder needs is known up front: */
+        output.insert(output.end(), lzw_magic, lzw_magic + sizeof(lzw_magic));
+        output.push_back(lzw_version);
+        output.push_back(word_width);
+
+        block.reserve(lzw_block_size);
+    }
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        for (consumed = 0;;)
+        {
+            /* A checked block is coded first: */
+            while (checked && coded < block.size())
+            {
+                if (full())
+                {
+                    return output_full;
+                }
+                code(block[coded++]);
+            }
+
+            if (consumed == in.size())
+            {
+                return need_input;
+            }
+
+            if (checked)
+            {
+                block.clear();
+                coded = 0;
+                checked = false;
+            }
+
+            const size_t n = std::min(in.size() - consumed, lzw_block_size - block.size());
+            block.insert(block.end(), in.begin() + consumed, in.begin() + consumed + n);
+            consumed += n;
+
+            if (block.size() == lzw_block_size)
+            {
+                check();
+            }
+        }
+    }
+
+    status finish() override
+    {
+        if (!finished)
+        {
+            if (!checked)
+            {
+                check();
+            }
+
+            /* Past the output limit this once, the encoder is done after it: */
+            while (coded < block.size())
+            {
+                code(block[coded++]);
+            }
+
+            if (dict.previous != dict.current)
+            {
+                write(dict.previous->bytes[dict.idx].second, code_width(dict.count));
+            }
+
+            /* Flush any remaining bits: */
+            if (bit_count)
+            {
+                output.push_back(static_cast<uint8_t>(bits << (8 - bit_count)));
+                bit_count = 0;
+            }
+
+            if (stats)
+            {
+                stats->word_width = word_width;
+                stats->maxsize = dict.maxsize;
+                stats->count = dict.count;
+                stats->resets = resets;
+                stats->stored_blocks = stored_blocks;
+            }
+
+            finished = true;
+        }
+
+        return pending_or(done);
+    }
+
+private:
+    comp::lzw_stats *stats;
+
+    Dictionary dict;
+    size_t resets = 0, stored_blocks = 0;
+    const uint8_t word_width;
+    ratio_monitor monitor;
+
+    /* Input gathered so far, `coded` bytes of it already coded once `checked`: */
+    std::vector<uint8_t> block;
+    size_t coded = 0;
+    bool checked = false;
+
+    /* Bits not yet making up a whole byte, MSB first: */
+    uint64_t bits = 0;
+    size_t bit_count = 0;
+
+    void code(uint8_t byte)
+    {
+        size_t code;
+
+        monitor.in_bytes++;
+
+        /* Width is determined by the largest index the decoder may see at this point: */
+        const uint8_t width = code_width(dict.count);
+
+        if (!dict.extend(byte, code))
+        {
+            write(code, width);
+            monitor.out_bits += width;
+
+            if (monitor.check(dict.count == dict.maxsize))
+            {
+                write(lzw_clear, code_width(dict.count));
+                dict.clear();
+                resets++;
+            }
+        }
+    }
+
+    /* Stores the block right away if it looks incompressible, else leaves it to code(): */
+    void check()
+    {
+        checked = true;
+
+        if (!comp::estimate::incompressible(block))
+        {
+            return;
+        }
+
+        uint8_t width = code_width(dict.count);
+
+        /* The current match goes first. The decoder only then adds the entry made for the code before it, and so
+         * expects the next code to be one wider than the encoder would think, unless the dictionary is full: */
+        if (dict.previous != dict.current)
+        {
+            write(dict.previous->bytes[dict.idx].second, width);
+            width = code_width(std::min(dict.count + 1, dict.maxsize));
+        }
+
+        write(lzw_clear, width);
+        dict.clear();
+        dict.reset();
+        write(lzw_clear, code_width(dict.count));
+        write(block.size() - 1, 16);
+
+        if (bit_count)
+        {
+            output.push_back(static_cast<uint8_t>(bits << (8 - bit_count)));
+            bit_count = 0;
+        }
+
+        output.insert(output.end(), block.begin(), block.end());
+        coded = block.size();
+        stored_blocks++;
+
+        /* Start over, as after any reset: */
+        monitor = ratio_monitor();
+    }
+
+    void write(size_t code, uint8_t width)
+    {
+        bits = (bits << width) | code;
+        bit_count += width;
+
+        while (bit_count >= 8)
+        {
+            bit_count -= 8;
+            output.push_back(static_cast<uint8_t>(bits >> bit_count));
+        }
+    }
+};
+
+/* Standard LZW decoding - the dictionary is rebuilt from the code stream alone.
+ * Entry `i` is stored as (index of its prefix, last byte); single bytes occupy indices 1, ..., 256, same as in `Dictionary`.
+ * Resumable: the header, and codes, may be split anywhere between fragments.
+ */
+class lzw_decoder : public comp::stream_coder
+{
+public:
+    /* No implicit-dictionary header: */
+    bool unknown_format = false;
+
+    lzw_decoder() : prefix(node::maxbytes + 1, 0), suffix(node::maxbytes + 1, 0)
+    {
+        for (size_t byte = 0; byte < node::maxbytes; byte++)
+        {
+            suffix[byte + 1] = byte;
+        }
+
+        Dictionary d;
+        maxsize = d.maxsize;
+    }
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        consumed = 0;
+
+        while (header_size < sizeof(header) && consumed < in.size())
+        {
+            header[header_size++] = in[consumed++];
+
+            if (header_size == sizeof(header))
+            {
+                check_header();
+            }
+        }
+
+        while (consumed < in.size() && !failed)
+        {
+            if (full())
+            {
+                return output_full;
+            }
+
+            if (stored_left)
+            {
+                const size_t n = std::min(stored_left, in.size() - consumed);
+
+                output.insert(output.end(), in.begin() + consumed, in.begin() + consumed + n);
+                stored_left -= n;
+                consumed += n;
+                continue;
+            }
+
+            buf = (buf << 8) | in[consumed++];
+            buf_size += 8;
+
+            decode_codes();
+        }
+
+        return failed ? corrupt : need_input;
+    }
+
+    /* Fewer than a code's worth of bits left: padding. */
+    status finish() override
+    {
+        failed = failed || header_size < sizeof(header) || stored_left || stored_size;
+        finished = true;
+
+        return pending_or(done);
+    }
+
+private:
+    /* magic | version | word width */
+    uint8_t header[sizeof(lzw_magic) + 2];
+    size_t header_size = 0;
+
+    uint8_t word_width = 0;
+    bool variable = false;
+    size_t maxsize;
+
+    /* Version 4: a clear code right after another starts a stored block; its size is read next, then its bytes: */
+    bool stored_blocks = false;
+    bool cleared = false;
+    bool stored_size = false;
+    size_t stored_left = 0;
+
+    std::vector<size_t> prefix;
+    std::vector<uint8_t> suffix;
+    std::vector<uint8_t> word;
+
+    uint64_t buf = 0;
+    size_t buf_size = 0;
+    size_t last = 0;
+
+    void check_header()
+    {
+        const uint8_t version = header[sizeof(lzw_magic)];
+        word_width = header[sizeof(lzw_magic) + 1];
+        variable = (version >= lzw_version_cleared);
+        stored_blocks = (version == lzw_version);
+
+        if (!std::equal(lzw_magic, lzw_magic + sizeof(lzw_magic), header) || version < lzw_version_fixed || version > lzw_version)
+        {
+            unknown_format = failed = true;
+        }
+
+        failed = failed || word_width == 0 || word_width > 32;
+    }
+
+    void decode_codes()
+    {
+        for (;;)
+        {
+            if (stored_size)
+            {
+                if (buf_size < 16)
+                {
+                    return;
+                }
+
+                buf_size -= 16;
+                stored_left = ((buf >> buf_size) & 0xFFFF) + 1;
+                stored_size = false;
+
+                /* Padding, then whatever of the block is already buffered: */
+                buf_size -= buf_size % 8;
+                while (stored_left && buf_size)
+                {
+                    buf_size -= 8;
+                    output.push_back(static_cast<uint8_t>(buf >> buf_size));
+                    stored_left--;
+                }
+
+                if (stored_left)
+                {
+                    return;
+                }
+            }
+
+            const size_t count = prefix.size() - 1;
+
+            /* The encoder is one entry ahead, unless there is nothing to pair `last` with (or no space left): */
+            const size_t limit = (last && count < maxsize) ? count + 1 : count;
+            const size_t width = variable ? code_width(limit) : word_width;
+
+            if (buf_size < width)
+            {
+                return;
+            }
+
+            buf_size -= width;
+            const size_t code = (buf >> buf_size) & ((0x1UL << width) - 1);
+
+            if (variable && code == lzw_clear)
+            {
+                prefix.resize(node::maxbytes + 1);
+                suffix.resize(node::maxbytes + 1);
+                last = 0;
+
+                stored_size = stored_blocks && cleared;
+                cleared = !stored_size;
+                continue;
+            }
+
+            cleared = false;
+
+            const bool kwkwk = (code == count + 1) && (limit == count + 1);
+
+            if (code == 0 || code > limit)
+            {
+                failed = true;
+                return;
+            }
+
+            /* Unwind the word, back to front. The KwKwK case (code not yet known) repeats the first byte of the previous word: */
+            word.clear();
+            for (size_t t = kwkwk ? last : code; t; t = prefix[t])
+            {
+                word.push_back(suffix[t]);
+            }
+
+            const uint8_t first = word.back();
+
+            if (kwkwk)
+            {
+                word.insert(word.begin(), first);
+            }
+
+            if (last && count < maxsize)
+            {
+                prefix.push_back(last);
+                suffix.push_back(first);
+            }
+
+            output.insert(output.end(), word.rbegin(), word.rend());
+            last = code;
+        }
+    }
+};
+
+comp::lzw_stats comp::lzw::encode(std::istream &in, std::ostream &out)
+{
+    lzw_stats stats;
+    lzw_encoder enc(&stats);
+
+    enc.run(in, out);
+    return stats;
+}
+
+comp::lzw::status comp::lzw::decode(std::istream &in, std::ostream &out)
+{
+    lzw_decoder dec;
+
+    if (dec.run(in, out) == stream_coder::done)
+    {
+        return ok;
+    }
+
+    return dec.unknown_format ? unknown_format : corrupt;
+}
+
+comp::lzw_stats comp::lzw::encode(input_file &in, output_file &out, comp::stats *timing)
+{
+    lzw_stats stats;
+    lzw_encoder enc(&stats);
+
+    enc.run(in, out, timing);
+    return stats;
+}
+
+comp::lzw::status comp::lzw::decode(input_file &in, output_file &out, comp::stats *timing)
+{
+    lzw_decoder dec;
+
+    if (dec.run(in, out, timing) == stream_coder::done)
+    {
+        return ok;
+    }
+
+    return dec.unknown_format ? unknown_format : corrupt;
+}
+
+comp::lzw_stats comp::lzw::encode(std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    lzw_stats stats;
+    lzw_encoder enc(&stats);
+
+    out.clear();
+    enc.run(in, out);
+    return stats;
+}
+
+comp::lzw::status comp::lzw::decode(std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    lzw_decoder dec;
+
+    out.clear();
+    if (dec.run(in, out) == stream_coder::done)
+    {
+        return ok;
+    }
+
+    return dec.unknown_format ? unknown_format : corrupt;
+}
+
+std::unique_ptr<comp::stream_coder> comp::lzw::encoder(lzw_stats *stats)
+{
+    return std::make_unique<lzw_encoder>(stats);
+}
+
+std::unique_ptr<comp::stream_coder> comp::lzw::decoder()
+{
+    return std::make_unique<lzw_decoder>();
+}
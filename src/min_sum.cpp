@@ -0,0 +1,220 @@
+#include "ldpc.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/* One int8 lane per frame. Written with GCC vector extensions, so the same kernel is compiled
+ * for AVX2, SSE4.1 and plain C++ (target_clones), and the best one is picked at load time.
+ * Storage goes through `lanes`: without AVX enabled, GCC only aligns v32i8 to 16 bytes. */
+typedef int8_t v32i8 __attribute__((vector_size(32)));
+typedef int16_t v32i16 __attribute__((vector_size(64)));
+
+struct alignas(32) lanes
+{
+    int8_t x[sizeof(v32i8)];
+};
+
+static_assert(sizeof(v32i8) == comp::ldpc::min_sum_lanes, "One lane per frame");
+
+/*
+ * Flooding schedule over the edge arrays of the Tanner graph:
+ * 1. check update: each check sends every bit the smallest magnitude among its other incoming messages
+ *    (min1, or min2 to a bit whose own magnitude is min1), signed by the parity of the other signs. When several bits
+ *    tie for min1, min2 equals it, so no position needs keeping and checks may have any degree;
+ * 2. bit update: total = channel + all incoming; each check gets back total minus its own message.
+ * Totals are kept in 16 bits, messages are saturated to [-127, 127].
+ */
+__attribute__((target_clones("avx2", "sse4.1", "default"))) static uint32_t min_sum_kernel(const comp::tanner_graph &g, const v32i8 *ch, v32i8 *c2v, v32i8 *v2c, v32i8 *hard,
+                                                                                              int max_iterations, uint8_t *iterations)
+{
+    const size_t num_bits = g.num_bits();
+    const size_t num_checks = g.num_checks();
+    const v32i8 zero = {};
+    const v32i8 top = zero + 127;
+
+    for (size_t e = 0; e < g.num_edges(); e++)
+    {
+        v2c[e] = ch[g.edge_var[e]];
+    }
+    for (size_t v = 0; v < num_bits; v++)
+    {
+        hard[v] = ch[v] < zero;
+    }
+
+    v32i8 done = zero;
+    int iteration;
+
+    for (iteration = 0;; ++iteration)
+    {
+        /* Syndrome of the current decisions: */
+        v32i8 failing = zero;
+        for (size_t check = 0; check < num_checks; ++check)
+        {
+            v32i8 parity = zero;
+            for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+            {
+                parity ^= hard[g.edge_var[e]];
+            }
+            failing |= parity;
+        }
+
+        const v32i8 fresh = (failing == zero) & ~done;
+        if (iterations)
+        {
+            for (size_t f = 0; f < comp::ldpc::min_sum_lanes; f++)
+            {
+                if (fresh[f])
+                {
+                    iterations[f] = iteration;
+                }
+            }
+        }
+        done |= fresh;
+
+        bool all_done = true;
+        for (size_t f = 0; f < comp::ldpc::min_sum_lanes; f++)
+        {
+            all_done = all_done && done[f];
+        }
+
+        if (iteration == max_iterations || all_done)
+        {
+            break;
+        }
+
+        /* 1. */
+        for (size_t check = 0; check < num_checks; ++check)
+        {
+            v32i8 min1 = top, min2 = top, sign = zero;
+
+            for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+            {
+                const v32i8 x = v2c[e];
+                const v32i8 mag = x < zero ? -x : x;
+                const v32i8 lower = mag < min1;
+
+                min2 = lower ? min1 : (mag < min2 ? mag : min2);
+                min1 = lower ? mag : min1;
+                sign ^= x;
+            }
+
+            const v32i8 least = min1;
+
+            /* Normalization factor 3/4: */
+            min1 -= min1 >> 2;
+            min2 -= min2 >> 2;
+
+            for (uint32_t e = g.check_ptr[check]; e < g.check_ptr[check + 1]; e++)
+            {
+                const v32i8 x = v2c[e];
+                const v32i8 mag = ((x < zero ? -x : x) == least) ? min2 : min1;
+                c2v[e] = ((sign ^ x) < zero) ? -mag : mag;
+            }
+        }
+
+        /* 2. */
+        for (size_t v = 0; v < num_bits; v++)
+        {
+            v32i16 total = __builtin_convertvector(ch[v], v32i16);
+
+            for (uint32_t i = g.var_ptr[v]; i < g.var_ptr[v + 1]; i++)
+            {
+                total += __builtin_convertvector(c2v[g.var_edge[i]], v32i16);
+            }
+
+            for (uint32_t i = g.var_ptr[v]; i < g.var_ptr[v + 1]; i++)
+            {
+                const uint32_t e = g.var_edge[i];
+                v32i16 out = total - __builtin_convertvector(c2v[e], v32i16);
+
+                out = out > 127 ? out - out + 127 : out;
+                out = out < -127 ? out - out - 127 : out;
+                v2c[e] = __builtin_convertvector(out, v32i8);
+            }
+
+            /* Frames that already converged keep their decisions: */
+            const v32i8 decision = __builtin_convertvector(total < 0, v32i8);
+            hard[v] = done ? hard[v] : decision;
+        }
+    }
+
+    uint32_t converged = 0;
+    for (size_t f = 0; f < comp::ldpc::min_sum_lanes; f++)
+    {
+        if (done[f])
+        {
+            converged |= 0x1U << f;
+        }
+        else if (iterations)
+        {
+            iterations[f] = iteration;
+        }
+    }
+
+    return converged;
+}
+
+uint32_t comp::ldpc::min_sum_decode_batch(const tanner_graph &g, const int8_t *llr, uint8_t *hard, int max_iterations, uint8_t *iterations)
+{
+    const size_t num_bits = g.num_bits();
+
+    std::vector<lanes> ch(num_bits), decisions(num_bits);
+    std::vector<lanes> c2v(g.num_edges()), v2c(g.num_edges());
+
+    std::memcpy(ch.data(), llr, num_bits * sizeof(lanes));
+    for (auto &block : ch)
+    {
+        /* Keep -x representable: */
+        for (auto &x : block.x)
+        {
+            x = std::max<int8_t>(x, -127);
+        }
+    }
+
+    auto vectors = [](std::vector<lanes> &v)
+    { return reinterpret_cast<v32i8 *>(v.data()); };
+
+    const uint32_t converged = min_sum_kernel(g, vectors(ch), vectors(c2v), vectors(v2c), vectors(decisions), max_iterations, iterations);
+
+    for (size_t v = 0; v < num_bits; v++)
+    {
+        for (size_t f = 0; f < min_sum_lanes; f++)
+        {
+            hard[v * min_sum_lanes + f] = decisions[v].x[f] ? 1 : 0;
+        }
+    }
+
+    return converged;
+}
+
+std::vector<int> comp::ldpc::min_sum_decode(const tanner_graph &g, const std::vector<int8_t> &llr, int max_iterations, int *iterations)
+{
+    const size_t num_bits = g.num_bits();
+
+    /* The other lanes get a confident all-zero frame, which converges right away: */
+    std::vector<int8_t> batch(num_bits * min_sum_lanes, 127);
+    std::vector<uint8_t> hard(num_bits * min_sum_lanes);
+    uint8_t counts[min_sum_lanes];
+
+    for (size_t v = 0; v < num_bits; v++)
+    {
+        batch[v * min_sum_lanes] = llr[v];
+    }
+
+    min_sum_decode_batch(g, batch.data(), hard.data(), max_iterations, counts);
+
+    if (iterations)
+    {
+        *iterations = counts[0];
+    }
+
+    std::vector<int> decoded(num_bits);
+    for (size_t v = 0; v < num_bits; v++)
+    {
+        decoded[v] = hard[v * min_sum_lanes];
+    }
+
+    return decoded;
+}
@@ -0,0 +1,235 @@
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <charconv>
+
+#include "container.hpp"
+#include "seekable.hpp"
+#include "codec.hpp"
+#include "file_io.hpp"
+#include "common.hpp"
+#include "stats.hpp"
+
+const char *const usage = "Usage: -e <filename> [-c auto|sf|huf|lz77|lzw] [-b <block KiB>] [-k] [--stats[=json]]\n"
+                          "       -d <filename> [-r <offset> <length>] [-o <output file>] [--stats[=json]]";
+
+/* False if `name` is neither a codec nor "auto": */
+static bool parse_codec(const std::string &name, bool &automatic, comp::codec_id &id)
+{
+    automatic = (name == "auto");
+
+    for (size_t i = 0; i < comp::codec::count && !automatic; i++)
+    {
+        if (name == comp::codec::name(static_cast<comp::codec_id>(i)))
+        {
+            id = static_cast<comp::codec_id>(i);
+            return true;
+        }
+    }
+
+    return automatic;
+}
+
+/* False unless all of `arg` is a number: */
+static bool parse_number(const char *arg, uint64_t &value)
+{
+    const char *end = arg + std::strlen(arg);
+    const auto [last, error] = std::from_chars(arg, end, value);
+
+    return error == std::errc() && last == end && last != arg;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string mode(argv[1]);
+    const std::string filename(argv[2]);
+    comp::stats::format format = comp::stats::off;
+    bool automatic = true;
+    comp::codec_id id = comp::codec_id::huffman;
+
+    /* Seekable format when given, or with checksums (which only blocks have): */
+    size_t block_size = 0;
+    bool checksums = false;
+
+    /* Range decoding when given, from a seekable file. A range is not the original, so it goes to stdout unless given -o: */
+    bool range = false;
+    uint64_t offset = 0, length = 0;
+    std::string out_filename;
+
+    const bool encoding = (mode == "-e");
+    bool valid = encoding || mode == "-d";
+
+    for (int i = 3; i < argc && valid; i++)
+    {
+        const std::string arg(argv[i]);
+        const int left = argc - i - 1;
+
+        if (arg == "-c" && left >= 1 && encoding)
+        {
+            valid = parse_codec(argv[++i], automatic, id);
+        }
+        else if (arg == "-b" && left >= 1 && encoding)
+        {
+            uint64_t kib;
+
+            /* Blocks below 4 GiB: */
+            valid = parse_number(argv[++i], kib) && kib > 0 && kib < (1ULL << 22);
+            block_size = kib << 10;
+        }
+        else if (arg == "-k" && encoding)
+        {
+            checksums = true;
+        }
+        else if (arg == "-r" && left >= 2 && !encoding)
+        {
+            range = true;
+            valid = parse_number(argv[i + 1], offset) && parse_number(argv[i + 2], length);
+            i += 2;
+        }
+        else if (arg == "-o" && left >= 1 && !encoding)
+        {
+            out_filename = argv[++i];
+        }
+        else
+        {
+            valid = comp::stats::parse(arg, format);
+        }
+    }
+
+    if (!valid)
+    {
+        std::cout << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (out_filename.empty())
+    {
+        out_filename = encoding ? filename + comp::container::ext : range ? "-" : comp::common::trim_string_ext(filename);
+    }
+
+    const std::unique_ptr<comp::stats> stats = comp::stats::make(format);
+
+    /* Statistics must not end up in a stream written to stdout: */
+    std::ostream &log = (out_filename == "-") ? std::cerr : std::cout;
+
+    comp::input_file in;
+    comp::output_file out;
+
+    if (!in.open(filename))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (range)
+    {
+        /* Only the blocks holding the range are decoded: */
+        comp::seekable::reader reader;
+        std::vector<uint8_t> data;
+        const std::span<const uint8_t> file = in.all();
+
+        if (in.failed())
+        {
+            return EXIT_FAILURE;
+        }
+
+        comp::stats::timer t(stats.get(), "range decoding");
+
+        if (!reader.open(file))
+        {
+            std::cerr << "Not a seekable file " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (!reader.read(offset, length, data))
+        {
+            std::cerr << "Corrupt file " << filename << std::endl;
+            return EXIT_FAILURE;
+        }
+        t.stop();
+
+        if (!out.open(out_filename, &in) || !out.write(data) || !out.close())
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (stats)
+        {
+            stats->set("blocks", reader.blocks());
+            stats->set("output_bytes", data.size());
+            stats->print(log);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /* The output is only created for an input with a container header: */
+    comp::codec_id header_id;
+
+    if (!encoding && !comp::container::identify(in.peek(comp::container::header_size), header_id))
+    {
+        std::cerr << (in.failed() ? "Error reading file " : "Not a container file ") << filename << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!out.open(out_filename, &in))
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* The codec comes from the header when decoding, and from the first bytes of the input when not given: */
+    std::unique_ptr<comp::stream_coder> coder;
+
+    if (checksums && !block_size)
+    {
+        block_size = comp::seekable::default_block_size;
+    }
+
+    if (encoding && block_size)
+    {
+        coder = automatic ? comp::seekable::encoder(block_size, checksums, stats.get())
+                          : comp::seekable::encoder(id, block_size, checksums, stats.get());
+    }
+    else if (encoding)
+    {
+        coder = automatic ? comp::container::encoder(stats.get()) : comp::container::encoder(id, stats.get());
+    }
+    else
+    {
+        coder = comp::container::decoder(stats.get());
+    }
+
+    const comp::stream_coder::status s = coder->run(in, out, stats.get());
+
+    if (in.failed())
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (s != comp::stream_coder::done)
+    {
+        std::cerr << "Corrupt file " << filename << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!out.close())
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (stats)
+    {
+        stats->print(log);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,447 @@
+#include "ldpc.hpp"
+
+#include <fstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+/* Base matrix file: */
+static const char qc_magic[] = {'L', 'D', 'P', 'Q'};
+static const uint8_t qc_version = 1;
+
+/* Shift redraws per circulant before a 4-cycle is accepted: */
+static const int qc_attempts = 64;
+
+void comp::qc_code::expand(tanner_graph &g) const
+{
+    std::vector<std::vector<uint32_t>> checks(num_checks());
+
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        for (uint32_t c = 0; c < cols; c++)
+        {
+            const int32_t s = shift[r * cols + c];
+            if (s < 0)
+            {
+                continue;
+            }
+
+            for (uint32_t i = 0; i < z; i++)
+            {
+                checks[r * z + i].push_back(c * z + (i + s) % z);
+            }
+        }
+    }
+
+    g.build(num_bits(), checks);
+}
+
+/*
+ * Format:
+ * { magic | version | rows | cols | Z | shift, rows * cols times }, all but the first two as 32-bit little endian (-1: zero block)
+ */
+bool comp::qc_code::save(const std::string &filename) const
+{
+    std::vector<char> buf;
+
+    auto put = [&buf](uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            buf.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    };
+
+    buf.insert(buf.end(), std::begin(qc_magic), std::end(qc_magic));
+    buf.push_back(qc_version);
+    put(rows);
+    put(cols);
+    put(z);
+
+    for (int32_t s : shift)
+    {
+        put(static_cast<uint32_t>(s));
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    out.write(buf.data(), buf.size());
+
+    return static_cast<bool>(out);
+}
+
+bool comp::qc_code::load(const std::string &filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+
+    if (!in.is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> buf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+
+    auto get = [&buf, &pos](int bytes, uint32_t &value)
+    {
+        if (pos + bytes > buf.size())
+        {
+            return false;
+        }
+
+        value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint32_t>(buf[pos++]) << (8 * i);
+        }
+        return true;
+    };
+
+    uint32_t magic, version, r, c, size;
+
+    if (!get(4, magic) || !std::equal(std::begin(qc_magic), std::end(qc_magic), buf.begin()) ||
+        !get(1, version) || version != qc_version ||
+        !get(4, r) || !get(4, c) || !get(4, size) || size == 0 ||
+        buf.size() - pos != static_cast<size_t>(r) * c * 4)
+    {
+        return false;
+    }
+
+    /* expand() builds Z checks per row block and Z bits per column block, within the limits of tanner_graph::load(): */
+    if (static_cast<uint64_t>(r) * size > tanner_graph::max_size || static_cast<uint64_t>(c) * size > tanner_graph::max_size)
+    {
+        return false;
+    }
+
+    std::vector<int32_t> shifts(static_cast<size_t>(r) * c);
+    uint64_t edges = 0;
+    for (auto &s : shifts)
+    {
+        uint32_t value = 0;
+        get(4, value);
+        s = static_cast<int32_t>(value);
+
+        if (s >= static_cast<int32_t>(size) || s < -1)
+        {
+            return false;
+        }
+        edges += (s >= 0) ? size : 0;
+    }
+
+    /* Edges are numbered in 32 bits: */
+    if (edges > UINT32_MAX)
+    {
+        return false;
+    }
+
+    rows = r;
+    cols = c;
+    z = size;
+    shift = std::move(shifts);
+    return true;
+}
+
+bool comp::ldpc::quasi_cyclic(qc_code &qc, uint32_t rows, uint32_t cols, uint32_t z, uint32_t w_c, uint64_t seed)
+{
+    if (z == 0 || w_c == 0 || w_c > rows)
+    {
+        return false;
+    }
+
+    qc.rows = rows;
+    qc.cols = cols;
+    qc.z = z;
+    qc.shift.assign(static_cast<size_t>(rows) * cols, -1);
+
+    Random rng(seed);
+    std::vector<uint32_t> used(rows, 0), order(rows);
+
+    auto at = [&qc](uint32_t r, uint32_t c) -> int32_t &
+    {
+        return qc.shift[r * qc.cols + c];
+    };
+
+    for (uint32_t c = 0; c < cols; c++)
+    {
+        /* Least used row blocks first, ties in random order: */
+        for (uint32_t r = 0; r < rows; r++)
+        {
+            order[r] = r;
+        }
+        for (uint32_t r = rows - 1; r > 0; r--)
+        {
+            std::swap(order[r], order[rng.below(r + 1)]);
+        }
+        std::stable_sort(order.begin(), order.end(), [&used](uint32_t a, uint32_t b)
+                         { return used[a] < used[b]; });
+
+        for (uint32_t k = 0; k < w_c; k++)
+        {
+            const uint32_t r1 = order[k];
+
+            /*
+             * Rows r1, r2 and columns c, c2 close a 4-cycle through the circulants iff
+             * s(r1, c) - s(r2, c) + s(r2, c2) - s(r1, c2) = 0 (mod Z).
+             */
+            for (int attempt = 0; attempt < qc_attempts; attempt++)
+            {
+                at(r1, c) = rng.below(z);
+                bool cycle = false;
+
+                for (uint32_t j = 0; j < k && !cycle; j++)
+                {
+                    const uint32_t r2 = order[j];
+
+                    for (uint32_t c2 = 0; c2 < c && !cycle; c2++)
+                    {
+                        if (at(r1, c2) < 0 || at(r2, c2) < 0)
+                        {
+                            continue;
+                        }
+
+                        const int64_t sum = static_cast<int64_t>(at(r1, c)) - at(r2, c) + at(r2, c2) - at(r1, c2);
+                        cycle = ((sum % z) + z) % z == 0;
+                    }
+                }
+
+                if (!cycle)
+                {
+                    break;
+                }
+            }
+
+            used[r1]++;
+        }
+    }
+
+    return true;
+}
+
+/* A circulant row is worked on 32 lanes at a time, in GCC vector types like min_sum.cpp's kernel, so that target_clones
+ * gets AVX2/SSE4.1 code at any optimization level. Rows are padded to whole vectors; the padding stays zero where it is read. */
+typedef int8_t v32i8 __attribute__((vector_size(32)));
+typedef int16_t v32i16 __attribute__((vector_size(64)));
+
+struct alignas(32) qc_lanes
+{
+    int8_t x[sizeof(v32i8)];
+};
+
+struct alignas(64) qc_wide_lanes
+{
+    int16_t x[sizeof(v32i16) / sizeof(int16_t)];
+};
+
+/*
+ * Normalized min-sum, flooding, exactly as min_sum_kernel() does it over the edges, but a circulant at a time:
+ * `c2v` holds one Z-long row per nonzero block (index = check within the row block), `total` one Z-long row per column block.
+ * Reading bit (z + s) % Z for check z is a rotation of the column block by s (two contiguous copies), writing back
+ * the opposite rotation. Everything else is element-wise over whole vectors.
+ */
+__attribute__((target_clones("avx2", "sse4.1", "default"))) static int qc_min_sum_kernel(const comp::qc_code &qc, const int8_t *ch, int8_t *hard,
+                                                                                           int max_iterations)
+{
+    const size_t z = qc.z;
+    const size_t width = sizeof(v32i8);
+    const size_t chunks = (z + width - 1) / width;
+
+    /* Nonzero blocks, in row order: */
+    std::vector<uint32_t> row_ptr(qc.rows + 1, 0), block_col, block_shift;
+    for (uint32_t r = 0; r < qc.rows; r++)
+    {
+        for (uint32_t c = 0; c < qc.cols; c++)
+        {
+            if (qc.shift[r * qc.cols + c] >= 0)
+            {
+                block_col.push_back(c);
+                block_shift.push_back(qc.shift[r * qc.cols + c]);
+            }
+        }
+        row_ptr[r + 1] = block_col.size();
+    }
+
+    size_t max_degree = 0;
+    for (uint32_t r = 0; r < qc.rows; r++)
+    {
+        max_degree = std::max<size_t>(max_degree, row_ptr[r + 1] - row_ptr[r]);
+    }
+
+    std::vector<qc_lanes> c2v_rows(block_col.size() * chunks), v2c_rows(max_degree * chunks), bit_rows(qc.cols * chunks);
+    std::vector<qc_lanes> parity_row(chunks), shifted_row(chunks);
+    std::vector<qc_wide_lanes> channel_rows(qc.cols * chunks), total_rows(qc.cols * chunks), next_rows(qc.cols * chunks), rotated_row(chunks);
+
+    v32i8 *c2v = reinterpret_cast<v32i8 *>(c2v_rows.data()), *v2c = reinterpret_cast<v32i8 *>(v2c_rows.data());
+    v32i8 *bits = reinterpret_cast<v32i8 *>(bit_rows.data());
+    v32i8 *parity = reinterpret_cast<v32i8 *>(parity_row.data()), *shifted = reinterpret_cast<v32i8 *>(shifted_row.data());
+    v32i16 *channel = reinterpret_cast<v32i16 *>(channel_rows.data()), *total = reinterpret_cast<v32i16 *>(total_rows.data());
+    v32i16 *next = reinterpret_cast<v32i16 *>(next_rows.data()), *rotated = reinterpret_cast<v32i16 *>(rotated_row.data());
+
+    /* Scalar views of the same rows, for the rotations: */
+    int8_t *const bytes_of_c2v = c2v_rows.data()->x, *const bytes_of_bits = bit_rows.data()->x, *const bytes_of_shifted = shifted_row.data()->x;
+    int16_t *words_of_total = total_rows.data()->x, *words_of_next = next_rows.data()->x, *const words_of_rotated = rotated_row.data()->x;
+
+    for (uint32_t c = 0; c < qc.cols; c++)
+    {
+        for (size_t i = 0; i < z; i++)
+        {
+            channel_rows[c * chunks + i / width].x[i % width] = ch[c * z + i];
+            bit_rows[c * chunks + i / width].x[i % width] = ch[c * z + i] < 0;
+        }
+    }
+    std::copy(channel, channel + qc.cols * chunks, total);
+
+    const v32i8 zero = {};
+    const v32i8 top = zero + 127;
+    int iteration;
+
+    for (iteration = 0;; ++iteration)
+    {
+        /* Syndrome of the current decisions, up to the first row block that fails: */
+        bool satisfied = true;
+        for (uint32_t r = 0; r < qc.rows && satisfied; r++)
+        {
+            std::fill(parity_row.begin(), parity_row.end(), qc_lanes{});
+
+            for (uint32_t b = row_ptr[r]; b < row_ptr[r + 1]; b++)
+            {
+                /* `to[i] = from[(i + s) % z]`: */
+                const int8_t *from = bytes_of_bits + block_col[b] * chunks * width;
+                const size_t s = block_shift[b];
+                std::copy(from + s, from + z, bytes_of_shifted);
+                std::copy(from, from + s, bytes_of_shifted + z - s);
+
+                for (size_t j = 0; j < chunks; j++)
+                {
+                    parity[j] ^= shifted[j];
+                }
+            }
+
+            v32i8 failing = zero;
+            for (size_t j = 0; j < chunks; j++)
+            {
+                failing |= parity[j];
+            }
+
+            for (size_t i = 0; i < width; i++)
+            {
+                satisfied = satisfied && !failing[i];
+            }
+        }
+
+        if (satisfied || iteration == max_iterations)
+        {
+            break;
+        }
+
+        std::copy(channel, channel + qc.cols * chunks, next);
+
+        for (uint32_t r = 0; r < qc.rows; r++)
+        {
+            const uint32_t degree = row_ptr[r + 1] - row_ptr[r];
+
+            /* 1. Messages into the checks of this row block, one Z-long row per block: */
+            for (uint32_t b = row_ptr[r], k = 0; b < row_ptr[r + 1]; b++, k++)
+            {
+                const int16_t *from = words_of_total + block_col[b] * chunks * width;
+                const size_t s = block_shift[b];
+                std::copy(from + s, from + z, words_of_rotated);
+                std::copy(from, from + s, words_of_rotated + z - s);
+
+                for (size_t j = 0; j < chunks; j++)
+                {
+                    v32i16 x = rotated[j] - __builtin_convertvector(c2v[b * chunks + j], v32i16);
+
+                    x = x > 127 ? x - x + 127 : x;
+                    x = x < -127 ? x - x - 127 : x;
+                    v2c[k * chunks + j] = __builtin_convertvector(x, v32i8);
+                }
+            }
+
+            /* 2. Check update, and the messages back: */
+            for (size_t j = 0; j < chunks; j++)
+            {
+                v32i8 min1 = top, min2 = top, sign = zero;
+
+                for (uint32_t k = 0; k < degree; k++)
+                {
+                    const v32i8 x = v2c[k * chunks + j];
+                    const v32i8 mag = x < zero ? -x : x;
+                    const v32i8 lower = mag < min1;
+
+                    min2 = lower ? min1 : (mag < min2 ? mag : min2);
+                    min1 = lower ? mag : min1;
+                    sign ^= x;
+                }
+
+                /* min2 goes to the blocks whose magnitude is min1, as in min_sum_kernel(): */
+                const v32i8 least = min1;
+
+                /* Normalization factor 3/4: */
+                min1 -= min1 >> 2;
+                min2 -= min2 >> 2;
+
+                for (uint32_t k = 0; k < degree; k++)
+                {
+                    const v32i8 x = v2c[k * chunks + j];
+                    const v32i8 mag = ((x < zero ? -x : x) == least) ? min2 : min1;
+                    c2v[(row_ptr[r] + k) * chunks + j] = ((sign ^ x) < zero) ? -mag : mag;
+                }
+            }
+
+            /* 3. Accumulated into the column blocks, `to[(i + s) % z] = from[i]`: */
+            for (uint32_t b = row_ptr[r]; b < row_ptr[r + 1]; b++)
+            {
+                const int8_t *from = bytes_of_c2v + b * chunks * width;
+                const size_t s = block_shift[b];
+                std::copy(from, from + z - s, bytes_of_shifted + s);
+                std::copy(from + z - s, from + z, bytes_of_shifted);
+
+                v32i16 *sum = next + block_col[b] * chunks;
+                for (size_t j = 0; j < chunks; j++)
+                {
+                    sum[j] += __builtin_convertvector(shifted[j], v32i16);
+                }
+            }
+        }
+
+        std::swap(total, next);
+        std::swap(words_of_total, words_of_next);
+        for (size_t j = 0; j < qc.cols * chunks; j++)
+        {
+            bits[j] = __builtin_convertvector(total[j] < 0, v32i8) & 1;
+        }
+    }
+
+    for (uint32_t c = 0; c < qc.cols; c++)
+    {
+        for (size_t i = 0; i < z; i++)
+        {
+            hard[c * z + i] = bit_rows[c * chunks + i / width].x[i % width];
+        }
+    }
+
+    return iteration;
+}
+
+std::vector<int> comp::ldpc::min_sum_decode(const qc_code &qc, const std::vector<int8_t> &llr, int max_iterations, int *iterations)
+{
+    const size_t num_bits = qc.num_bits();
+
+    std::vector<int8_t> ch(num_bits), hard(num_bits);
+    for (size_t v = 0; v < num_bits; v++)
+    {
+        /* Keep -x representable: */
+        ch[v] = std::max<int8_t>(llr[v], -127);
+    }
+
+    const int count = qc_min_sum_kernel(qc, ch.data(), hard.data(), max_iterations);
+
+    if (iterations)
+    {
+        *iterations = count;
+    }
+
+    return std::vector<int>(hard.begin(), hard.end());
+}
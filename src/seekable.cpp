@@ -0,0 +1,375 @@
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <algorithm>
+
+#include "seekable.hpp"
+#include "container.hpp"
+#include "checksum.hpp"
+#include "stats.hpp"
+
+const uint8_t end_magic[] = {'C', 'M', 'P', 'I'};
+
+const size_t entry_size = 8 + 4;
+const size_t trailer_size = 8 + 8 + sizeof(end_magic);
+
+/* Little endian: */
+static void put(std::vector<uint8_t> &out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static uint64_t get(const uint8_t *in, int bytes)
+{
+    uint64_t value = 0;
+
+    for (int i = 0; i < bytes; i++)
+    {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+
+    return value;
+}
+
+class seekable_encoder : public comp::stream_coder
+{
+public:
+    seekable_encoder(bool automatic, comp::codec_id id, size_t block_size, bool checksums, comp::stats *timing)
+        : automatic(automatic), id(id), block_size(block_size), checksums(checksums), timing(timing) {}
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        for (consumed = 0; consumed < in.size();)
+        {
+            if (full())
+            {
+                return output_full;
+            }
+
+            const size_t n = std::min(in.size() - consumed, block_size - block.size());
+
+            block.insert(block.end(), in.begin() + consumed, in.begin() + consumed + n);
+            consumed += n;
+
+            if (block.size() == block_size)
+            {
+                put_block();
+            }
+        }
+
+        return need_input;
+    }
+
+    status finish() override
+    {
+        if (finished)
+        {
+            return pending_or(done);
+        }
+        mark = output.size();
+
+        if (!block.empty() || !started)
+        {
+            put_block();
+        }
+
+        /* 3. */
+        put(output, 0, 4);
+        const uint64_t index_offset = position();
+
+        /* 4. */
+        for (auto &[offset, size] : index)
+        {
+            put(output, offset, 8);
+            put(output, size, 4);
+        }
+
+        /* 5. */
+        put(output, index_offset, 8);
+        put(output, index.size(), 8);
+        output.insert(output.end(), end_magic, end_magic + sizeof(end_magic));
+
+        count();
+
+        if (timing)
+        {
+            timing->set("blocks", index.size());
+        }
+
+        finished = true;
+        return pending_or(done);
+    }
+
+private:
+    const bool automatic;
+    comp::codec_id id;
+    const size_t block_size;
+    const bool checksums;
+    comp::stats *const timing;
+
+    bool started = false;
+    std::vector<uint8_t> block, coded;
+    std::vector<std::pair<uint64_t, uint32_t>> index;
+
+    /* drain() forgets what it hands out, so output is counted as it is appended: `produced` up to output[mark]. Every
+     * function that appends sets the mark on entry and counts on its way out, so drain() never runs past the mark: */
+    uint64_t produced = 0;
+    size_t mark = 0;
+
+    uint64_t position() const
+    {
+        return produced + (output.size() - mark);
+    }
+
+    void count()
+    {
+        produced = position();
+        mark = output.size();
+    }
+
+    /* An empty block only for an empty input, so the header is there: */
+    void put_block()
+    {
+        mark = output.size();
+
+        if (!started)
+        {
+            if (automatic)
+            {
+                comp::stats::timer t(timing, "codec choice");
+                id = comp::container::choose(block);
+            }
+
+            if (timing)
+            {
+                timing->set("codec", static_cast<double>(id));
+            }
+
+            /* 1. */
+            comp::container::put_header(output, id, comp::container::seekable_version, checksums);
+            started = true;
+        }
+
+        if (!block.empty())
+        {
+            /* 2. The checksum while the block is still in cache: */
+            uint32_t crc = 0;
+            if (checksums)
+            {
+                comp::stats::timer t(timing, "checksum");
+                crc = comp::checksum::crc32c(block);
+            }
+
+            comp::codec::compress(id, block, coded);
+            index.emplace_back(position(), block.size());
+            put(output, coded.size(), 4);
+            if (checksums)
+            {
+                put(output, crc, 4);
+            }
+            output.insert(output.end(), coded.begin(), coded.end());
+            block.clear();
+        }
+
+        count();
+    }
+};
+
+class seekable_decoder : public comp::stream_coder
+{
+public:
+    seekable_decoder(comp::codec_id id, bool checksums) : id(id), prefix_size(checksums ? 8 : 4) {}
+
+    status feed(std::span<const uint8_t> in, size_t &consumed) override
+    {
+        for (consumed = 0; consumed < in.size() && !failed;)
+        {
+            if (full())
+            {
+                return output_full;
+            }
+
+            if (ended)
+            {
+                /* Index and trailer: only the last bytes are looked at, by finish() */
+                const size_t n = in.size() - consumed;
+
+                tail.insert(tail.end(), in.begin() + consumed, in.end());
+                consumed += n;
+                tail_size += n;
+
+                if (tail.size() > 2 * trailer_size)
+                {
+                    tail.erase(tail.begin(), tail.end() - trailer_size);
+                }
+                continue;
+            }
+
+            if (prefix_bytes < prefix_size)
+            {
+                prefix |= static_cast<uint64_t>(in[consumed++]) << (8 * prefix_bytes++);
+
+                /* 3. */
+                ended = (prefix_bytes == 4 && prefix == 0);
+                continue;
+            }
+
+            const uint32_t length = static_cast<uint32_t>(prefix);
+            const size_t n = std::min<size_t>(in.size() - consumed, length - block.size());
+
+            block.insert(block.end(), in.begin() + consumed, in.begin() + consumed + n);
+            consumed += n;
+
+            if (block.size() == length)
+            {
+                failed = !comp::codec::decompress(id, block, decoded) ||
+                         (prefix_size == 8 && comp::checksum::crc32c(decoded) != static_cast<uint32_t>(prefix >> 32));
+                output.insert(output.end(), decoded.begin(), decoded.end());
+                blocks++;
+
+                block.clear();
+                prefix = 0;
+                prefix_bytes = 0;
+            }
+        }
+
+        return failed ? corrupt : need_input;
+    }
+
+    status finish() override
+    {
+        if (!finished)
+        {
+            /* The index must be there and hold an entry per block: */
+            failed = failed || !ended || tail_size != blocks * entry_size + trailer_size ||
+                     !std::equal(end_magic, end_magic + sizeof(end_magic), tail.end() - sizeof(end_magic)) ||
+                     get(&tail[tail.size() - trailer_size + 8], 8) != blocks;
+            finished = true;
+        }
+
+        return pending_or(done);
+    }
+
+private:
+    const comp::codec_id id;
+
+    /* { compressed size | checksum, if any }: */
+    const size_t prefix_size;
+    uint64_t prefix = 0;
+    size_t prefix_bytes = 0;
+    std::vector<uint8_t> block, decoded;
+    uint64_t blocks = 0;
+
+    bool ended = false;
+    std::vector<uint8_t> tail;
+    uint64_t tail_size = 0;
+};
+
+std::unique_ptr<comp::stream_coder> comp::seekable::encoder(codec_id id, size_t block_size, bool checksums, stats *timing)
+{
+    return std::make_unique<seekable_encoder>(false, id, block_size, checksums, timing);
+}
+
+std::unique_ptr<comp::stream_coder> comp::seekable::encoder(size_t block_size, bool checksums, stats *timing)
+{
+    return std::make_unique<seekable_encoder>(true, codec_id::huffman, block_size, checksums, timing);
+}
+
+std::unique_ptr<comp::stream_coder> comp::seekable::decoder(codec_id id, bool checksums)
+{
+    return std::make_unique<seekable_decoder>(id, checksums);
+}
+
+bool comp::seekable::reader::open(std::span<const uint8_t> in)
+{
+    uint8_t version;
+
+    offsets.assign(1, 0);
+    starts.assign(1, 0);
+
+    if (!container::identify(in, id, version, sums) || version != container::seekable_version ||
+        in.size() < container::header_size + 4 + trailer_size ||
+        !std::equal(end_magic, end_magic + sizeof(end_magic), in.end() - sizeof(end_magic)))
+    {
+        return false;
+    }
+
+    /* 5. */
+    const uint8_t *trailer = in.data() + in.size() - trailer_size;
+    const uint64_t index_offset = get(trailer, 8);
+    const uint64_t count = get(trailer + 8, 8);
+
+    if (index_offset < container::header_size + 4 || count > (in.size() - trailer_size) / entry_size ||
+        index_offset + count * entry_size + trailer_size != in.size())
+    {
+        return false;
+    }
+
+    /* 4. Blocks follow each other from the header up to the 0 before the index, none empty. Their own sizes are checked as they are read: */
+    const size_t prefix = sums ? 8 : 4;
+
+    offsets.resize(count + 1);
+    starts.resize(count + 1);
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint8_t *entry = in.data() + index_offset + i * entry_size;
+
+        offsets[i] = get(entry, 8);
+        starts[i + 1] = starts[i] + get(entry + 8, 4);
+
+        if ((i == 0 && offsets[i] != container::header_size) || (i > 0 && offsets[i] <= offsets[i - 1] + prefix) ||
+            offsets[i] + prefix > index_offset - 4 || starts[i + 1] == starts[i])
+        {
+            offsets.assign(1, 0);
+            starts.assign(1, 0);
+            return false;
+        }
+    }
+    offsets[count] = index_offset - 4;
+
+    if (!count && offsets[0] != container::header_size)
+    {
+        offsets.assign(1, 0);
+        starts.assign(1, 0);
+        return false;
+    }
+
+    file = in;
+    return true;
+}
+
+bool comp::seekable::reader::read(uint64_t offset, uint64_t length, std::vector<uint8_t> &out)
+{
+    if (offset >= size() || !length)
+    {
+        return true;
+    }
+
+    const uint64_t end = offset + std::min(length, size() - offset);
+
+    /* The last block starting at or before `offset`: */
+    size_t b = std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+
+    for (; b < blocks() && starts[b] < end; b++)
+    {
+        const size_t prefix = sums ? 8 : 4;
+        const uint64_t coded = offsets[b + 1] - offsets[b] - prefix;
+
+        if (get(file.data() + offsets[b], 4) != coded || !codec::decompress(id, file.subspan(offsets[b] + prefix, coded), decoded) ||
+            decoded.size() != starts[b + 1] - starts[b] || (sums && checksum::crc32c(decoded) != get(file.data() + offsets[b] + 4, 4)))
+        {
+            return false;
+        }
+
+        const uint64_t from = std::max(offset, starts[b]) - starts[b];
+        const uint64_t to = std::min(end, starts[b + 1]) - starts[b];
+
+        out.insert(out.end(), decoded.begin() + from, decoded.begin() + to);
+    }
+
+    return true;
+}
@@ -0,0 +1,114 @@
+#include "stats.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+bool comp::stats::parse(const std::string &arg, format &f)
+{
+    if (arg == "--stats")
+    {
+        f = text;
+    }
+    else if (arg == "--stats=json")
+    {
+        f = json;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<comp::stats> comp::stats::make(format f)
+{
+    return (f == off) ? nullptr : std::unique_ptr<stats>(new stats(f));
+}
+
+comp::stats::stats(format f) : output(f) {}
+
+comp::stats::timer::timer(stats *s, const char *stage) : owner(s), stage(stage)
+{
+    if (owner)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+comp::stats::timer::~timer()
+{
+    stop();
+}
+
+void comp::stats::timer::stop()
+{
+    if (owner)
+    {
+        owner->add_time(stage, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        owner = nullptr;
+    }
+}
+
+/* Few entries, in the order they were first recorded, which is the order the stages ran in: */
+static void add(std::vector<std::pair<std::string, double>> &entries, const std::string &name, double value, bool sum)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [&name](const auto &e)
+                           { return e.first == name; });
+
+    if (it == entries.end())
+    {
+        entries.emplace_back(name, value);
+    }
+    else
+    {
+        it->second = sum ? it->second + value : value;
+    }
+}
+
+void comp::stats::add_time(const std::string &stage, double seconds)
+{
+    add(stages, stage, seconds, true);
+}
+
+void comp::stats::set(const std::string &counter, double value)
+{
+    add(counters, counter, value, false);
+}
+
+void comp::stats::print(std::ostream &to) const
+{
+    /* Whatever format `to` was left in, counts come out whole and times with all their digits: */
+    std::ostringstream out;
+    out << std::setprecision(9);
+
+    if (output == text)
+    {
+        for (const auto &[stage, seconds] : stages)
+        {
+            out << "Stage " << stage << ": " << seconds << " s" << std::endl;
+        }
+        for (const auto &[counter, value] : counters)
+        {
+            out << counter << ": " << value << std::endl;
+        }
+    }
+    else
+    {
+        /* Names are fixed strings from the tools, nothing to escape: */
+        out << "{\"stages\": {";
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            out << (i ? ", " : "") << "\"" << stages[i].first << "\": " << stages[i].second;
+        }
+        out << "}, \"counters\": {";
+        for (size_t i = 0; i < counters.size(); i++)
+        {
+            out << (i ? ", " : "") << "\"" << counters[i].first << "\": " << counters[i].second;
+        }
+        out << "}}" << std::endl;
+    }
+
+    to << out.str();
+}
@@ -0,0 +1,175 @@
+#include <cstring>
+#include <algorithm>
+
+#include "stream.hpp"
+#include "file_io.hpp"
+#include "stats.hpp"
+
+comp::stream_coder::status comp::stream_coder::drain(std::span<uint8_t> out, size_t &written)
+{
+    written = std::min(out.size(), output.size() - drained);
+    if (written)
+    {
+        std::memcpy(out.data(), output.data() + drained, written);
+        drained += written;
+    }
+
+    /* Everything taken, start over at the front (capacity stays): */
+    if (drained == output.size())
+    {
+        output.clear();
+        drained = 0;
+    }
+    else if (drained >= output_limit)
+    {
+        /* Partial drains: move the rest down, or the buffer would keep growing at the back */
+        output.erase(output.begin(), output.begin() + drained);
+        drained = 0;
+    }
+
+    return pending_or(finished ? done : need_input);
+}
+
+comp::stream_coder::status comp::stream_coder::run(std::span<const uint8_t> in, std::vector<uint8_t> &out)
+{
+    status s = need_input;
+
+    while (s != corrupt && s != done)
+    {
+        if (in.empty())
+        {
+            s = finish();
+        }
+        else
+        {
+            size_t consumed;
+            s = feed(in, consumed);
+            in = in.subspan(consumed);
+        }
+
+        /* Nothing is limited here, take all of it: */
+        out.insert(out.end(), output.begin() + drained, output.end());
+        output.clear();
+        drained = 0;
+
+        s = pending_or(s);
+    }
+
+    return s;
+}
+
+comp::stream_coder::status comp::stream_coder::run(std::istream &in, std::ostream &out)
+{
+    std::vector<char> chunk(output_limit);
+    status s = need_input;
+
+    while (s != corrupt && s != done)
+    {
+        if (in.read(chunk.data(), chunk.size()) || in.gcount())
+        {
+            std::span<const uint8_t> rest(reinterpret_cast<const uint8_t *>(chunk.data()), in.gcount());
+
+            while (!rest.empty() && s != corrupt)
+            {
+                size_t consumed;
+                s = feed(rest, consumed);
+                rest = rest.subspan(consumed);
+
+                out.write(reinterpret_cast<const char *>(output.data() + drained), output.size() - drained);
+                output.clear();
+                drained = 0;
+            }
+        }
+        else
+        {
+            s = finish();
+
+            out.write(reinterpret_cast<const char *>(output.data() + drained), output.size() - drained);
+            output.clear();
+            drained = 0;
+        }
+
+        s = pending_or(s);
+    }
+
+    out.flush();
+    return s;
+}
+
+comp::stream_coder::status comp::stream_coder::run(input_file &in, output_file &out, stats *st)
+{
+    /* Three stages: the next block is read and the previous output written while this thread codes: */
+    read_ahead reader(in);
+    write_behind writer(out);
+    status s = need_input;
+    size_t input_bytes = 0, output_bytes = 0;
+
+    /* Hands the pending output over to the writer in place, taking an empty buffer back: */
+    const auto hand_over = [&]()
+    {
+        if (output.size() > drained)
+        {
+            output_bytes += output.size() - drained;
+
+            stats::timer wait(st, "write wait");
+            std::vector<uint8_t> pending = writer.buffer();
+            wait.stop();
+
+            output.erase(output.begin(), output.begin() + drained);
+            std::swap(pending, output);
+            writer.write(std::move(pending));
+        }
+
+        output.clear();
+        drained = 0;
+    };
+
+    while (s != corrupt && s != done)
+    {
+        stats::timer wait(st, "read wait");
+        std::span<const uint8_t> rest = reader.next();
+        wait.stop();
+
+        input_bytes += rest.size();
+
+        if (rest.empty())
+        {
+            if (in.failed())
+            {
+                s = corrupt;
+                break;
+            }
+
+            stats::timer coding(st, "coding");
+            s = finish();
+        }
+
+        while (!rest.empty() && s != corrupt)
+        {
+            stats::timer coding(st, "coding");
+            size_t consumed;
+            s = feed(rest, consumed);
+            rest = rest.subspan(consumed);
+            coding.stop();
+
+            if (full())
+            {
+                hand_over();
+            }
+        }
+
+        hand_over();
+        s = pending_or(s);
+    }
+
+    stats::timer wait(st, "write wait");
+    writer.finish();
+    wait.stop();
+
+    if (st)
+    {
+        st->set("input_bytes", input_bytes);
+        st->set("output_bytes", output_bytes);
+    }
+    return s;
+}
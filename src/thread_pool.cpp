@@ -0,0 +1,76 @@
+#include "thread_pool.hpp"
+
+#include <thread>
+#include <utility>
+#include <algorithm>
+
+comp::ThreadPool::ThreadPool(size_t count)
+{
+    if (count == 0)
+    {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        workers.emplace_back(&ThreadPool::_run, this);
+    }
+}
+
+comp::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+
+    /* Tasks still queued are finished first: */
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::future<void> comp::ThreadPool::submit(std::function<void()> fn)
+{
+    std::packaged_task<void()> task(std::move(fn));
+    auto result = task.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+    }
+    cv.notify_one();
+
+    return result;
+}
+
+size_t comp::ThreadPool::size() const
+{
+    return workers.size();
+}
+
+void comp::ThreadPool::_run()
+{
+    for (;;)
+    {
+        std::packaged_task<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]
+                    { return stop || !tasks.empty(); });
+
+            if (tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}